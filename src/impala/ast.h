@@ -41,6 +41,7 @@ class Stmt;
 class NameSema;
 class InferSema;
 class TypeSema;
+class BorrowSema;
 class CodeGen;
 
 typedef ArrayRef<std::unique_ptr<const ASTType>> ASTTypeArgs;
@@ -61,6 +62,14 @@ typedef thorin::HashMap<Symbol, const FieldDecl*> FieldTable;
 typedef thorin::HashMap<Symbol, const FnDecl*> MethodTable;
 typedef thorin::HashMap<Symbol, const Item*> Symbol2Item;
 
+/// The <tt>#[...]</tt> attributes in front of an item or a block.
+struct Attributes {
+    bool fast_math = false;
+    bool has_target_clones = false;
+    Strings target_clones; ///< Empty if the driver's defaults apply.
+    unsigned align = 0;    ///< Of <tt>#[align(N)]</tt> - a power of two; 0 if there is none.
+};
+
 /**
  * Assigns @p src's @p Expr::back_ref_ to @p dst and returns @p src.
  * In a typical @p ASTNode owning an @p Expr you should have a member:
@@ -298,10 +307,11 @@ class PtrASTType : public ASTType {
 public:
     enum Kind { Borrowed, Mut, Owned };
 
-    PtrASTType(Location location, Kind kind, int addr_space, const ASTType* referenced_ast_type)
+    PtrASTType(Location location, Kind kind, int addr_space, unsigned align, const ASTType* referenced_ast_type)
         : ASTType(location)
         , kind_(kind)
         , addr_space_(addr_space)
+        , align_(align)
         , referenced_ast_type_(referenced_ast_type)
     {}
 
@@ -309,6 +319,8 @@ public:
     std::string prefix() const;
     const ASTType* referenced_ast_type() const { return referenced_ast_type_.get(); }
     int addr_space() const { return addr_space_; }
+    /// Of <tt>&align(N) T</tt>; 0 if there is none.
+    unsigned align() const { return align_; }
 
     std::ostream& stream(std::ostream&) const override;
     void check(NameSema&) const override;
@@ -319,6 +331,7 @@ private:
 
     Kind kind_;
     int addr_space_;
+    unsigned align_;
     std::unique_ptr<const ASTType> referenced_ast_type_;
 };
 
@@ -467,12 +480,15 @@ private:
 
 class SimdASTType : public ArrayASTType {
 public:
-    SimdASTType(Location location, const ASTType* elem_ast_type, uint64_t size)
+    SimdASTType(Location location, const ASTType* elem_ast_type, uint64_t size, bool is_native = false)
         : ArrayASTType(location, elem_ast_type)
         , size_(size)
+        , is_native_(is_native)
     {}
 
     uint64_t size() const { return size_; }
+    /// @c simd[T * native] - as many lanes as fit into a vector register of the target; @p size is meaningless.
+    bool is_native() const { return is_native_; }
 
     std::ostream& stream(std::ostream&) const override;
     void check(NameSema&) const override;
@@ -482,6 +498,7 @@ private:
     void check(TypeSema&) const override;
 
     uint64_t size_;
+    bool is_native_;
 };
 
 //------------------------------------------------------------------------------
@@ -642,6 +659,13 @@ public:
     Param(Location location, size_t handle, const Identifier* id, const ASTType* ast_type)
         : LocalDecl(location, handle, /*mut*/ false, id, ast_type)
     {}
+
+    /// A @c &mut parameter whose argument is unique at each call site - set by @p borrow_check.
+    bool is_noalias() const { return noalias_; }
+    void mark_noalias() const { noalias_ = true; }
+
+private:
+    mutable bool noalias_ = false;
 };
 
 class Fn : public ASTTypeParamList {
@@ -667,6 +691,8 @@ public:
 
     virtual const FnType* fn_type() const = 0;
     virtual Symbol fn_symbol() const = 0;
+    /// Marked with @c #[fast_math] - its floating-point arithmetic may be reassociated, contracted and approximated.
+    virtual bool is_fast_math() const { return false; }
 
 protected:
     Params params_;
@@ -676,6 +702,8 @@ protected:
 
 private:
     std::unique_ptr<const Expr> body_;
+
+    friend class CodeGen;
 };
 
 //------------------------------------------------------------------------------
@@ -710,6 +738,7 @@ public:
 private:
     virtual void check(InferSema&) const = 0;
     virtual void check(TypeSema&) const = 0;
+    virtual void check(BorrowSema&) const = 0;
     virtual void emit(CodeGen&) const = 0;
 
     Visibility visibility_;
@@ -717,6 +746,7 @@ private:
     friend class CodeGen;
     friend class InferSema;
     friend class TypeSema;
+    friend class BorrowSema;
 };
 
 class TypeDeclItem : public Item, public ASTTypeParamList {
@@ -754,6 +784,7 @@ public:
     void check(NameSema&) const override;
     void check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     void emit(CodeGen&) const override;
     std::ostream& stream(std::ostream&) const override;
 
@@ -774,6 +805,7 @@ public:
 private:
     void check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     void emit(CodeGen&) const override;
 };
 
@@ -794,6 +826,7 @@ public:
 private:
     void check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     void emit(CodeGen&) const override;
 
     Symbol abi_;
@@ -816,6 +849,7 @@ public:
 private:
     void check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     void emit(CodeGen&) const override;
 
     std::unique_ptr<const ASTType> ast_type_;
@@ -852,9 +886,10 @@ private:
 class StructDecl : public TypeDeclItem {
 public:
     StructDecl(Location location, Visibility vis, const Identifier* id,
-               ASTTypeParams&& ast_type_params, FieldDecls&& field_decls)
+               ASTTypeParams&& ast_type_params, FieldDecls&& field_decls, unsigned align = 0)
         : TypeDeclItem(location, vis, id, std::move(ast_type_params))
         , field_decls_(std::move(field_decls))
+        , align_(align)
     {}
 
     size_t num_field_decls() const { return field_decls_.size(); }
@@ -863,6 +898,8 @@ public:
     const FieldDecl* field_decl(size_t i) const { return field_decls_[i].get(); }
     const FieldDecl* field_decl(Symbol symbol) const { return thorin::find(field_table_, symbol); }
     const FieldDecl* field_decl(const Identifier* ident) const { return field_decl(ident->symbol()); }
+    /// Of <tt>#[align(N)]</tt> - variables and statics of this struct are aligned to @c N bytes; 0 if there is none.
+    unsigned align() const { return align_; }
 
     std::ostream& stream(std::ostream&) const override;
     void check(NameSema&) const override;
@@ -870,9 +907,11 @@ public:
 private:
     void check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     void emit(CodeGen&) const override;
 
     FieldDecls field_decls_;
+    unsigned align_;
     mutable FieldTable field_table_;
 };
 
@@ -884,18 +923,22 @@ public:
 private:
     void check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     void emit(CodeGen&) const override;
 };
 
 class StaticItem : public ValueItem {
 public:
     StaticItem(Location location, Visibility vis, bool mut, const Identifier* id,
-               const ASTType* ast_type, const Expr* init)
+               const ASTType* ast_type, const Expr* init, unsigned align = 0)
         : ValueItem(location, vis, mut, id, std::move(ast_type))
         , init_(dock(init_, init))
+        , align_(align)
     {}
 
     const Expr* init() const { return init_.get(); }
+    /// Of <tt>#[align(N)]</tt>; 0 if there is none - see also @p StructDecl::align.
+    unsigned align() const { return align_; }
 
     std::ostream& stream(std::ostream&) const override;
     void check(NameSema&) const override;
@@ -903,24 +946,42 @@ public:
 private:
     void check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     thorin::Value emit(CodeGen&, const thorin::Def* init) const override;
 
     std::unique_ptr<const Expr> init_;
+    unsigned align_;
 };
 
 class FnDecl : public ValueItem, public Fn {
 public:
     FnDecl(Location location, Visibility vis, bool is_extern, Symbol abi, Symbol export_name,
-           const Identifier* id, ASTTypeParams&& ast_type_params, Params&& params, const Expr* body)
+           const Identifier* id, ASTTypeParams&& ast_type_params, Params&& params, const Expr* body,
+           Attributes&& attributes = Attributes())
         : ValueItem(location, vis, /*mut*/ false, id, /*ast_type*/ nullptr)
         , Fn(std::move(ast_type_params), std::move(params), body)
         , abi_(abi)
         , export_name_(export_name)
         , is_extern_(is_extern)
+        , attributes_(std::move(attributes))
     {}
 
+    enum Intrinsic {
+        NoIntrinsic,
+#define IMPALA_INTRINSIC(name) Intrinsic_##name,
+#include "impala/intrinsiclist.h"
+    };
+
     bool is_extern() const { return is_extern_; }
     Symbol abi() const { return abi_; }
+    const Attributes& attributes() const { return attributes_; }
+    /// Marked with @c #[target_clones] - emitted once per target feature and dispatched at runtime.
+    bool has_target_clones() const { return attributes_.has_target_clones; }
+    /// The features of the @c #[target_clones] attribute - empty if the driver's defaults apply.
+    const Strings& target_clones() const { return attributes_.target_clones; }
+    bool is_fast_math() const override { return attributes_.fast_math; }
+    /// Set during @p NameSema for functions of an <tt>extern "thorin"</tt> block.
+    Intrinsic intrinsic() const { return intrinsic_; }
 
     const FnType* fn_type() const override {
         auto t = type();
@@ -935,11 +996,14 @@ public:
 private:
     void check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     thorin::Value emit(CodeGen&, const thorin::Def* init) const override;
 
     Symbol abi_;
     Symbol export_name_;
     bool is_extern_ = false;
+    Attributes attributes_;
+    mutable Intrinsic intrinsic_ = NoIntrinsic;
 };
 
 class TraitDecl : public Item, public ASTTypeParamList {
@@ -962,6 +1026,7 @@ public:
 private:
     void check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     void emit(CodeGen&) const override;
 
     ASTTypeApps super_traits_;
@@ -994,6 +1059,7 @@ public:
 private:
     void check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     void emit(CodeGen&) const override;
 
     std::unique_ptr<const ASTType> trait_;
@@ -1028,6 +1094,7 @@ public:
 private:
     virtual const Type* check(InferSema&) const = 0;
     virtual void check(TypeSema&) const = 0;
+    virtual void check(BorrowSema&) const = 0;
     virtual thorin::Value lemit(CodeGen&) const;
     virtual const thorin::Def* remit(CodeGen&) const;
     virtual void emit_jump(CodeGen&, thorin::JumpTarget&) const;
@@ -1058,6 +1125,7 @@ protected:
     friend class CodeGen;
     friend class InferSema;
     friend class TypeSema;
+    friend class BorrowSema;
 };
 
 /**
@@ -1108,6 +1176,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     const thorin::Def* remit(CodeGen&) const override;
 };
 
@@ -1137,6 +1206,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
 
     Kind kind_;
     thorin::Box box_;
@@ -1160,6 +1230,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
 
     Symbol symbol_;
     char value_;
@@ -1185,6 +1256,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     thorin::Value lemit(CodeGen&) const override;
 
     Symbols symbols_;
@@ -1207,6 +1279,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     const thorin::Def* remit(CodeGen&) const override;
 
     size_t ret_var_handle_;
@@ -1231,6 +1304,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     thorin::Value lemit(CodeGen&) const override;
 
     std::unique_ptr<const Path> path_;
@@ -1244,10 +1318,11 @@ public:
 #include "impala/tokenlist.h"
     };
 
-    PrefixExpr(Location location, Kind kind, const Expr* rhs)
+    PrefixExpr(Location location, Kind kind, const Expr* rhs, bool mut = false)
         : Expr(location)
         , kind_(kind)
         , rhs_(dock(rhs_, rhs))
+        , mut_(mut)
     {}
 
     static const PrefixExpr* create(const Expr* rhs, const Kind kind) {
@@ -1259,6 +1334,8 @@ public:
 
     const Expr* rhs() const { return rhs_.get(); }
     Kind kind() const { return kind_; }
+    /// A mutable borrow @c &mut.
+    bool is_mut() const { return mut_; }
 
     bool is_lvalue() const override;
     bool has_side_effect() const override;
@@ -1272,9 +1349,11 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
 
     Kind kind_;
     std::unique_ptr<const Expr> rhs_;
+    bool mut_;
 };
 
 class InfixExpr : public Expr {
@@ -1306,6 +1385,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
 
     Kind kind_;
     std::unique_ptr<const Expr> lhs_;
@@ -1341,6 +1421,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
 
     Kind kind_;
     std::unique_ptr<const Expr> lhs_;
@@ -1369,6 +1450,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     thorin::Value lemit(CodeGen&) const override;
     const thorin::Def* remit(CodeGen&) const override;
 
@@ -1392,6 +1474,7 @@ public:
 
 private:
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     const thorin::Def* remit(CodeGen&) const override;
 
 protected:
@@ -1446,6 +1529,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     const thorin::Def* remit(CodeGen&) const override;
 };
 
@@ -1466,6 +1550,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     const thorin::Def* remit(CodeGen&) const override;
 
     std::unique_ptr<const Expr> value_;
@@ -1489,6 +1574,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     const thorin::Def* remit(CodeGen&) const override;
 
     std::unique_ptr<const Expr> dim_;
@@ -1508,6 +1594,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     const thorin::Def* remit(CodeGen&) const override;
 };
 
@@ -1524,6 +1611,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     const thorin::Def* remit(CodeGen&) const override;
 };
 
@@ -1569,6 +1657,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     const thorin::Def* remit(CodeGen&) const override;
 
     std::unique_ptr<const ASTTypeApp> ast_type_app_;
@@ -1603,6 +1692,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     thorin::Value lemit(CodeGen&) const override;
     const thorin::Def* remit(CodeGen&) const override;
 
@@ -1634,6 +1724,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     thorin::Value lemit(CodeGen&) const override;
     const thorin::Def* remit(CodeGen&) const override;
     const thorin::Def* remit(CodeGen&, State, Location) const;
@@ -1652,10 +1743,11 @@ protected:
 
 class BlockExprBase : public StmtLikeExpr {
 public:
-    BlockExprBase(Location location, Stmts&& stmts, const Expr* expr)
+    BlockExprBase(Location location, Stmts&& stmts, const Expr* expr, bool fast_math)
         : StmtLikeExpr(location)
         , stmts_(std::move(stmts))
         , expr_(dock(expr_, expr))
+        , fast_math_(fast_math)
     {}
 
     const Stmts& stmts() const { return stmts_; }
@@ -1664,6 +1756,8 @@ public:
     bool empty() const { return stmts_.empty() && expr_->isa<EmptyExpr>(); }
     const LocalDecls& locals() const { return locals_; }
     void add_local(const LocalDecl* local) const { locals_.push_back(local); }
+    /// Marked with @c #[fast_math]; see @p Fn::is_fast_math.
+    bool is_fast_math() const { return fast_math_; }
 
     virtual const char* prefix() const = 0;
     bool has_side_effect() const override;
@@ -1674,21 +1768,23 @@ public:
 protected:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     const thorin::Def* remit(CodeGen&) const override;
 
     Stmts stmts_;
     std::unique_ptr<const Expr> expr_;
+    bool fast_math_;
     mutable LocalDecls locals_; ///< All \p LocalDecl%s in this \p BlockExprBase from top to bottom.
 };
 
 class BlockExpr : public BlockExprBase {
 public:
-    BlockExpr(Location location, Stmts&& stmts, const Expr* expr)
-        : BlockExprBase(location, std::move(stmts), expr)
+    BlockExpr(Location location, Stmts&& stmts, const Expr* expr, bool fast_math = false)
+        : BlockExprBase(location, std::move(stmts), expr, fast_math)
     {}
 
     BlockExpr(Location location)
-        : BlockExprBase(location, Stmts(), new EmptyExpr(location))
+        : BlockExprBase(location, Stmts(), new EmptyExpr(location), false)
     {}
 
     const char* prefix() const override { return "{"; }
@@ -1696,8 +1792,8 @@ public:
 
 class RunBlockExpr : public BlockExprBase {
 public:
-    RunBlockExpr(Location location, Stmts&& stmts, const Expr* expr)
-        : BlockExprBase(location, std::move(stmts), expr)
+    RunBlockExpr(Location location, Stmts&& stmts, const Expr* expr, bool fast_math = false)
+        : BlockExprBase(location, std::move(stmts), expr, fast_math)
     {}
 
     const char* prefix() const override { return "@{"; }
@@ -1730,6 +1826,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
 
     std::unique_ptr<const Expr> cond_;
     std::unique_ptr<const Expr> then_expr_;
@@ -1762,6 +1859,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
 
     std::unique_ptr<const LocalDecl> continue_decl_;
     std::unique_ptr<const Expr> cond_;
@@ -1790,6 +1888,7 @@ public:
 private:
     const Type* check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     const thorin::Def* remit(CodeGen&) const override;
 
     std::unique_ptr<const Expr> fn_expr_;
@@ -1880,9 +1979,11 @@ public:
 private:
     virtual void check(InferSema&) const = 0;
     virtual void check(TypeSema&) const = 0;
+    virtual void check(BorrowSema&) const = 0;
 
     friend class InferSema;
     friend class TypeSema;
+    friend class BorrowSema;
 };
 
 class ExprStmt : public Stmt {
@@ -1901,6 +2002,7 @@ public:
 private:
     void check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
 
     std::unique_ptr<const Expr> expr_;
 };
@@ -1921,6 +2023,7 @@ public:
 private:
     void check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
 
     std::unique_ptr<const Item> item_;
 };
@@ -1943,6 +2046,7 @@ public:
 private:
     void check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
 
     std::unique_ptr<const Ptrn> ptrn_;
     std::unique_ptr<const Expr> init_;
@@ -2007,6 +2111,7 @@ public:
     void check(NameSema&) const override;
     void check(InferSema&) const override;
     void check(TypeSema&) const override;
+    void check(BorrowSema&) const override;
     void emit(CodeGen&) const override;
 
 private:
@@ -0,0 +1,32 @@
+#ifndef IMPALA_BF16_H
+#define IMPALA_BF16_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace impala {
+
+/**
+ * @c bf16 is the upper half of an IEEE single-precision float.
+ * Thorin has no such type, so its values are kept as bits in a @c u16 and widened to @c f32 for arithmetic.
+ */
+
+/// Rounds @p f to the nearest @c bf16 - ties to even - and returns its bits; NaNs stay quiet NaNs.
+inline uint16_t bf16_from_float(float f) {
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    if ((bits & 0x7fffffff) > 0x7f800000)
+        return uint16_t((bits >> 16) | 0x40);
+    return uint16_t((bits + 0x7fff + ((bits >> 16) & 1)) >> 16);
+}
+
+inline float bf16_to_float(uint16_t bf16) {
+    uint32_t bits = uint32_t(bf16) << 16;
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+}
+
+#endif
@@ -58,6 +58,9 @@ private:
                 case PrimType_f16:
                     ctype_prefix = "half"; ctype_suffix = "";
                     return true;
+                case PrimType_bf16: // passed as its bits, see impala/bf16.h
+                    ctype_prefix = "unsigned short"; ctype_suffix = "";
+                    return true;
                 case PrimType_f32:
                     ctype_prefix = "float"; ctype_suffix = "";
                     return true;
@@ -0,0 +1,71 @@
+#include <sstream>
+#include <unordered_map>
+
+#include "thorin/continuation.h"
+#include "thorin/world.h"
+
+#include "impala/closurereport.h"
+#include "impala/impala.h"
+
+namespace impala {
+
+/// Copies of a lambda made by the partial evaluator keep its location, so the location identifies a lambda.
+static std::string key(const thorin::Location& location) {
+    std::ostringstream os;
+    os << location;
+    return os.str();
+}
+
+void ClosureReport::add(thorin::Location location) {
+    lambdas_.push_back({location, key(location)});
+}
+
+/// Is @p continuation used in any other way than being called or being passed to an intrinsic?
+static bool is_escaping(const thorin::Continuation* continuation) {
+    for (auto use : continuation->uses()) {
+        if (auto caller = use.def()->isa_continuation()) {
+            if (use.index() == 0)
+                continue;
+            if (auto callee = caller->callee()->isa_continuation()) {
+                if (callee->is_intrinsic())
+                    continue;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+void ClosureReport::collect(thorin::World& world) {
+    std::unordered_map<std::string, Kind> kinds;
+    for (auto continuation : world.continuations()) {
+        if (continuation->empty() || continuation->name().compare(0, 6, "lambda") != 0)
+            continue;
+        auto& kind = kinds.emplace(key(continuation->location()), Eliminated).first->second;
+        if (kind != Escaping)
+            kind = is_escaping(continuation) ? Escaping : Direct;
+    }
+
+    for (auto& lambda : lambdas_) {
+        auto i = kinds.find(lambda.key);
+        lambda.kind = i == kinds.end() ? Eliminated : i->second;
+    }
+}
+
+void ClosureReport::warn() const {
+    for (const auto& lambda : lambdas_) {
+        if (lambda.kind == Escaping)
+            warning(lambda.location, "lambda survives optimization as a closure");
+    }
+}
+
+std::ostream& ClosureReport::stream_text(std::ostream& os) const {
+    for (const auto& lambda : lambdas_) {
+        os << lambda.location << ": lambda "
+           << (lambda.kind == Eliminated ? "eliminated" : lambda.kind == Direct ? "called directly" : "escapes as a closure")
+           << std::endl;
+    }
+    return os;
+}
+
+}
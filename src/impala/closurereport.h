@@ -0,0 +1,48 @@
+#ifndef IMPALA_CLOSUREREPORT_H
+#define IMPALA_CLOSUREREPORT_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "thorin/util/location.h"
+
+namespace thorin {
+    class World;
+}
+
+namespace impala {
+
+/**
+ * Classifies each lambda - i.e. each @p FnExpr - by what is left of it after optimization.
+ * @p emit records the location of each lambda; @p collect has to be invoked on the final @p World.
+ */
+class ClosureReport {
+public:
+    enum Kind {
+        Eliminated, ///< Completely inlined or specialized away.
+        Direct,     ///< Survives but is only called directly - or handed to an intrinsic like @c parallel.
+        Escaping,   ///< Survives as a first-class value and needs a closure.
+    };
+
+    struct Lambda {
+        thorin::Location location;
+        std::string key;
+        Kind kind = Eliminated;
+    };
+
+    const std::vector<Lambda>& lambdas() const { return lambdas_; }
+    void add(thorin::Location);
+    void collect(thorin::World&);
+    /// Emits a warning for each @p Escaping lambda.
+    void warn() const;
+    /// Lists the @p Kind of each lambda.
+    std::ostream& stream_text(std::ostream&) const;
+
+private:
+    std::vector<Lambda> lambdas_;
+};
+
+}
+
+#endif
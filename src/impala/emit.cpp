@@ -1,11 +1,27 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <map>
+#include <queue>
+#include <sstream>
+
 #include "impala/ast.h"
+#include "impala/bf16.h"
+#include "impala/closurereport.h"
+#include "impala/impala.h"
+#include "impala/llvm.h"
+#include "impala/pereport.h"
+#include "impala/target.h"
 
 #include "thorin/irbuilder.h"
 #include "thorin/continuation.h"
 #include "thorin/primop.h"
 #include "thorin/type.h"
 #include "thorin/world.h"
+#include "thorin/analyses/scope.h"
+#include "thorin/transform/mangle.h"
 #include "thorin/util/array.h"
+#include "thorin/util/log.h"
 
 using namespace thorin;
 
@@ -13,8 +29,10 @@ namespace impala {
 
 class CodeGen : public IRBuilder {
 public:
-    CodeGen(World& world)
+    CodeGen(World& world, const EmitOptions& options)
         : IRBuilder(world)
+        , options(options)
+        , fast_math(options.fast_math)
     {}
 
     const Def* frame() const { assert(cur_fn); return cur_fn->frame(); }
@@ -56,6 +74,35 @@ public:
     const Def* remit(const Expr* expr, MapExpr::State state, Location eval_loc) {
         return expr->as<MapExpr>()->remit(*this, state, eval_loc);
     }
+    /// @c world().binop on operands of Impala type @p type;
+    /// on Thorin's quick floating-point types if in a @c #[fast_math] scope or if @p quick is set.
+    const Def* emit_binop(int tag, const Def* lhs, const Def* rhs, const Type* type, Location loc, bool quick = false);
+    /// Whether @p type is @c bf16 or a simd vector of @c bf16 - Thorin only sees their bits as @c u16.
+    bool has_bf16_lanes(const Type* type) {
+        if (type == nullptr)
+            return false;
+        type = instantiate(type);
+        if (auto simd_type = type->isa<SimdType>())
+            type = simd_type->elem_type();
+        return is_bf16(type);
+    }
+    /// Widens the bits of the @c bf16 scalar or vector @p def to @c f32.
+    const Def* widen_bf16(const Def* def, Location loc);
+    /// Rounds the @c f32 scalar or vector @p def to the nearest @c bf16 and returns its bits.
+    const Def* narrow_to_bf16(const Def* def, Location loc);
+    /// Tells LLVM via @c llvm.assume that the address @p ptr is a multiple of @p align - LLVM then aligns the accesses through it.
+    const Def* assume_aligned(const Def* ptr, uint64_t align, Location loc);
+    /// The function @p name - e.g. an LLVM intrinsic - imported with C calling convention once per @p name.
+    Continuation* import(const std::string& name, const thorin::FnType* fn_type, Location loc) {
+        auto& continuation = imports_[name];
+        if (continuation == nullptr) {
+            continuation = world().continuation(fn_type, {loc, name});
+            continuation->cc() = thorin::CC::C;
+        }
+        return continuation;
+    }
+    /// Calls the builtin for @p intrinsic with @p args; @p ret_type is @c nullptr if the builtin returns nothing.
+    const Def* call_builtin(FnDecl::Intrinsic intrinsic, ArrayRef<const Def*> args, const thorin::Type* ret_type, Location loc);
     void emit_jump(const Expr* expr, JumpTarget& x) { if (is_reachable()) expr->emit_jump(*this, x); }
     void emit_branch(const Expr* expr, JumpTarget& t, JumpTarget& f) { expr->emit_branch(*this, t, f); }
     void emit(const Stmt* stmt) { if (is_reachable()) stmt->emit(*this); }
@@ -76,7 +123,59 @@ public:
             decl->value_ = decl->emit(*this, init);
         return decl->value_;
     }
+    /// Forgets that the nested @p item has been emitted - a block is emitted anew for each instance or target clone.
+    void reset(const Item* item) {
+        item->done_ = false;
+        if (auto fn_decl = item->isa<FnDecl>())
+            fn_decl->value_ = Value(); // the nested function of another instance or clone must not be reused
+    }
+    /// Emits the body of @p fn_decl into @p continuation instead of its own continuation.
+    void emit_body(const FnDecl* fn_decl, Continuation* continuation) {
+        auto own = fn_decl->continuation_;
+        fn_decl->continuation_ = continuation;
+        fn_decl->emit_body(*this, fn_decl->location());
+        fn_decl->continuation_ = own;
+    }
+    /// Emits @p local at its declaration - anew each time an instance or a target clone reemits the same body.
+    Value emit_local(const LocalDecl* local, const Def* init) { return local->value_ = local->emit(*this, init); }
+    /// The body of @p fn_decl will be emitted by @p emit_bodies instead of right after its head.
+    void defer(const FnDecl* fn_decl) { if (fn_decl->body()) deferred_.insert(fn_decl); }
+    bool is_deferred(const FnDecl* fn_decl) const { return deferred_.contains(fn_decl); }
+    /// Schedules the body of a deferred @p fn_decl - does nothing if it is already scheduled or not deferred at all.
+    void enqueue(const FnDecl* fn_decl) {
+        if (is_deferred(fn_decl) && !thorin::visit(enqueued_, fn_decl))
+            queue_.push(fn_decl);
+    }
+    /// Emits enqueued bodies until no more bodies are referenced.
+    void emit_bodies() {
+        assert(cur_bb == nullptr && cur_fn == nullptr);
+        while (!queue_.empty() || !instance_queue_.empty()) {
+            if (!queue_.empty()) {
+                auto fn_decl = queue_.front();
+                queue_.pop();
+                emit_body(fn_decl);
+            } else {
+                auto instance = instance_queue_.front();
+                instance_queue_.pop();
+                emit_instance(instance);
+            }
+        }
+    }
+    void emit_body(const FnDecl* fn_decl) {
+        if (fn_decl->has_target_clones())
+            emit_target_clones(fn_decl);
+        else
+            fn_decl->emit_body(*this, fn_decl->location());
+    }
+    /// Emits the body of @p fn_decl once per target feature; its head becomes the dispatcher.
+    void emit_target_clones(const FnDecl* fn_decl);
+    /// Returns the instance of the polymorphic @p fn_decl for @p type_args; its body is enqueued the first time only.
+    Continuation* instantiate(const FnDecl* fn_decl, std::vector<const Type*> type_args);
+    /// Substitutes the type arguments of the instance currently emitted in @p type.
+    const Type* instantiate(const Type* type);
     const thorin::Type* convert(const Type* type) {
+        if (!type_args_.empty())
+            type = instantiate(type);
         if (auto t = thorin_type(type))
             return t;
         auto t = convert_rec(type);
@@ -89,7 +188,50 @@ public:
     const thorin::Type*& thorin_type(const Type* type) { return impala2thorin_[type]; }
     const thorin::StructType*& thorin_struct_type(const StructType* type) { return struct_type_impala2thorin_[type]; }
 
+    /// Remembers that @p caller's callee is wrapped in a @c run; see @p check_runs.
+    void add_run(Continuation* caller, Location location, bool is_block) {
+        run_sites_.push_back({caller, location, is_block, false});
+    }
+    /// Remembers a plain call for @c -auto-pe; see @p mark_runs.
+    void add_call(Continuation* caller, Location location) {
+        if (options.auto_pe)
+            calls_.push_back({caller, location, false, true});
+    }
+    void mark_runs();
+    void check_runs();
+    std::vector<Continuation*> unfold(Continuation* callee, size_t depth, Location location);
+
+    const EmitOptions& options;
     const Fn* cur_fn = nullptr;
+    bool fast_math; ///< Inside a @c #[fast_math] function or block or compiling with @c -ffast-math.
+    std::map<std::string, Continuation*> imports_;
+    thorin::HashSet<const FnDecl*> deferred_;
+    thorin::HashSet<const FnDecl*> enqueued_;
+    std::queue<const FnDecl*> queue_;
+
+    struct RunSite {
+        Continuation* caller;
+        Location location;
+        bool is_block;
+        bool is_auto;
+    };
+    std::vector<RunSite> run_sites_;
+    std::vector<RunSite> calls_;
+
+    struct Instance {
+        const FnDecl* fn_decl;
+        std::vector<const Type*> type_args;
+        Continuation* continuation;
+    };
+    void emit_instance(const Instance&);
+    std::map<std::pair<const FnDecl*, std::vector<const Type*>>, Continuation*> instances_;
+    std::queue<Instance> instance_queue_;
+    std::vector<const Type*> type_args_; ///< Type arguments of the instance currently emitted.
+    TypeMap<const Type*> instantiated_;  ///< Caches @p instantiate for the current instance.
+    size_t num_instantiations_ = 0;
+
+    void report_run(const RunSite&, Continuation* callee, size_t size, const std::string& residual,
+                    const std::vector<Continuation*>& copies);
     TypeMap<const thorin::Type*> impala2thorin_;
     GIDMap<const StructType*, const thorin::StructType*> struct_type_impala2thorin_;
 };
@@ -145,6 +287,239 @@ const thorin::Type* CodeGen::convert_rec(const Type* type) {
     THORIN_UNREACHABLE;
 }
 
+/*
+ * alignment
+ */
+
+const Def* CodeGen::assume_aligned(const Def* ptr, uint64_t align, Location loc) {
+    if (align <= 1 || !is_reachable())
+        return ptr;
+
+    // the pattern of LLVM's alignment assumptions: ((ptrtoint ptr) & (align - 1)) == 0
+    auto& w = world();
+    auto addr = w.convert(w.type_pu64(), ptr, loc);
+    auto offset = w.arithop(ArithOp_and, addr, w.literal_pu64(align - 1, loc), loc);
+    auto cond = w.cmp(Cmp_eq, offset, w.literal_pu64(0, loc), loc);
+    auto fn_type = w.fn_type({w.mem_type(), w.type_bool(), w.fn_type({w.mem_type()})});
+    call(import("llvm.assume", fn_type, loc), {get_mem(), cond}, w.tuple_type({}), {loc, "assume_cont"});
+    set_mem(cur_bb->param(0));
+    return ptr;
+}
+
+/// The alignment of the addresses of @p type; 0 if it is no pointer with an <tt>align(N)</tt> annotation.
+static unsigned ptr_align(const Type* type) {
+    auto ptr_type = type->isa<PtrType>();
+    return ptr_type ? ptr_type->align() : 0;
+}
+
+/// The alignment requested with <tt>#[align(N)]</tt> for variables of @p type; 0 if there is none.
+static unsigned storage_align(const Type* type) {
+    if (auto array_type = type->isa<DefiniteArrayType>())
+        return storage_align(array_type->elem_type());
+    if (auto struct_type = type->isa<StructType>())
+        return struct_type->struct_decl()->align();
+    return 0;
+}
+
+/// Thorin knows no alignment - @p finish_llvm finds variables to align by the @p align_marker in their names.
+static thorin::Debug aligned_debug(const Decl* decl, unsigned align) {
+    if (align == 0)
+        return decl->debug();
+    return {decl->location(), decl->symbol().str() + align_marker + std::to_string(align)};
+}
+
+/*
+ * Instances of polymorphic functions
+ */
+
+Continuation* CodeGen::instantiate(const FnDecl* fn_decl, std::vector<const Type*> type_args) {
+    ++num_instantiations_;
+    auto& result = instances_[std::make_pair(fn_decl, type_args)];
+    if (result == nullptr) {
+        // same order as InferSema::reduce: the outermost lambda binds the last type argument
+        const Type* type = fn_decl->type();
+        for (size_t i = type_args.size(); i-- != 0;)
+            type = type->typetable().app(type, type_args[i]);
+        result = continuation(convert(type)->as<thorin::FnType>(), {fn_decl->location(), fn_decl->fn_symbol().remove_quotation()});
+        instance_queue_.push({fn_decl, std::move(type_args), result});
+    }
+    return result;
+}
+
+/// Closes @p type over the type parameters of the current instance and applies it to the type arguments again.
+const Type* CodeGen::instantiate(const Type* type) {
+    if (type_args_.empty())
+        return type;
+
+    auto& result = instantiated_[type];
+    if (result == nullptr) {
+        auto& typetable = type->typetable();
+        const Type* t = type;
+        for (size_t i = 0, e = type_args_.size(); i != e; ++i)
+            t = typetable.lambda(t, "instance");
+        for (size_t i = type_args_.size(); i-- != 0;)
+            t = typetable.app(t, type_args_[i]);
+        result = t;
+    }
+    return result;
+}
+
+void CodeGen::emit_instance(const Instance& instance) {
+    type_args_ = instance.type_args;
+    instantiated_.clear();
+    emit_body(instance.fn_decl, instance.continuation);
+    type_args_.clear();
+}
+
+/*
+ * target clones
+ */
+
+/// The registers eax, ebx, ecx and edx after the x86 instruction @c cpuid for @p leaf and subleaf 0.
+static std::array<const Def*, 4> cpuid(CodeGen& cg, uint32_t leaf, Location loc) {
+    auto& w = cg.world();
+    Array<const thorin::Type*> outs = {w.type_pu32(), w.type_pu32(), w.type_pu32(), w.type_pu32()};
+    Array<const Def*> ins = {w.literal_pu32(leaf, loc), w.literal_pu32(0, loc)};
+    Array<std::string> output_constraints = {"={eax}", "={ebx}", "={ecx}", "={edx}"};
+    Array<std::string> input_constraints = {"{eax}", "{ecx}"};
+    auto assembly = w.assembly(outs, cg.get_mem(), ins, "cpuid", output_constraints, input_constraints,
+                               Array<std::string>(), thorin::Assembly::Flags::NoFlag, loc);
+    cg.set_mem(assembly->out(0));
+    return {{assembly->out(1), assembly->out(2), assembly->out(3), assembly->out(4)}};
+}
+
+/// XCR0 - the register state saved by the OS - via the x86 instruction @c xgetbv; only valid if @c cpuid reports OSXSAVE.
+static const Def* xgetbv(CodeGen& cg, Location loc) {
+    auto& w = cg.world();
+    Array<const thorin::Type*> outs = {w.type_pu32(), w.type_pu32()};
+    Array<const Def*> ins = {w.literal_pu32(0, loc)};
+    Array<std::string> output_constraints = {"={eax}", "={edx}"};
+    Array<std::string> input_constraints = {"{ecx}"};
+    auto assembly = w.assembly(outs, cg.get_mem(), ins, "xgetbv", output_constraints, input_constraints,
+                               Array<std::string>(), thorin::Assembly::Flags::NoFlag, loc);
+    cg.set_mem(assembly->out(0));
+    return assembly->out(1); // the state components of targetlist.h are in the lower half
+}
+
+/**
+ * Whether the CPU and the OS support @p feature according to the results of @c cpuid for leaf 1 and leaf 7 and
+ * according to @p xcr0.
+ */
+static const Def* supports(CodeGen& cg, TargetFeature feature, const std::array<const Def*, 4>& leaf1,
+                           const std::array<const Def*, 4>& leaf7, const Def* xcr0, Location loc) {
+    enum { eax, ebx, ecx, edx };
+    const Def* reg = nullptr;
+    uint32_t bit = 0, state = 0;
+    switch (feature) {
+#define IMPALA_TARGET(id, str, leaf, r, b, x) \
+        case TargetFeature_##id: reg = (leaf == 1 ? leaf1 : leaf7)[r]; bit = b; state = x; break;
+#include "impala/targetlist.h"
+        default: THORIN_UNREACHABLE;
+    }
+    auto& w = cg.world();
+    auto flag = w.arithop(ArithOp_and, reg, w.literal_pu32(1u << bit, loc), loc);
+    auto cpu = w.cmp(Cmp_ne, flag, w.literal_pu32(0, loc), loc);
+    if (state == 0)
+        return cpu;
+    auto saved = w.arithop(ArithOp_and, xcr0, w.literal_pu32(state, loc), loc);
+    return w.arithop(ArithOp_and, cpu, w.cmp(Cmp_eq, saved, w.literal_pu32(state, loc), loc), loc);
+}
+
+static const uint32_t Monotonic = 2; ///< LLVM's encoding of a relaxed memory ordering.
+static const uint32_t SeqCst    = 7; ///< LLVM's encoding of a sequentially consistent memory ordering.
+
+/*
+ * The clones are external such that Thorin does not inline them into the dispatcher and such that finish_llvm finds
+ * them in the LLVM module in order to add their target features.
+ * The dispatcher runs cpuid on its first call only; the index of the chosen clone is cached in a global.
+ * Threads may race on the first call - they all store the same index, so relaxed atomics suffice for the cache.
+ * Leaf 7 is only used if leaf 0 reports it, and AVX and AVX-512 only if the OS saves their registers according to XCR0.
+ * Only x86 provides cpuid - on other targets the default clone is the function itself.
+ */
+void CodeGen::emit_target_clones(const FnDecl* fn_decl) {
+    auto loc = fn_decl->location();
+    auto dispatcher = fn_decl->continuation();
+    auto name = fn_decl->fn_symbol().remove_quotation();
+
+    if (!is_x86_target()) {
+        warning(loc, "target clones need an x86 target; only the default clone of '%' is emitted", name);
+        fn_decl->emit_body(*this, loc);
+        return;
+    }
+
+    std::vector<TargetFeature> features; // from the least to the most preferred one
+    for (const auto& feature : fn_decl->target_clones().empty() ? options.default_target_clones : fn_decl->target_clones())
+        features.push_back(target_feature(feature));
+    std::sort(features.begin(), features.end());
+    features.erase(std::unique(features.begin(), features.end()), features.end());
+
+    std::vector<Continuation*> clones; // clones[0] uses none of the features
+    for (size_t i = 0, e = features.size() + 1; i != e; ++i) {
+        std::string suffix = i == 0 ? "default" : target_feature_name(features[i - 1]);
+        std::replace(suffix.begin(), suffix.end(), '.', '_');
+        auto clone = continuation(dispatcher->type(), {loc, name + "_" + suffix});
+        if (i != 0) {
+            clone->make_external();
+            if (options.target_clones)
+                options.target_clones->push_back({name + "_" + suffix, features[i - 1]});
+        }
+        emit_body(fn_decl, clone);
+        clones.push_back(clone);
+    }
+
+    THORIN_PUSH(cur_bb, dispatcher);
+    set_mem(dispatcher->param(0));
+    auto& w = world();
+    auto cache = w.global(w.literal_qs32(-1, loc), /*mutable*/ true, loc);
+    auto relaxed = w.literal_pu32(Monotonic, loc);
+    auto load_cache = [&] { return call_builtin(FnDecl::Intrinsic_atomic_load, {cache, relaxed}, w.type_qs32(), loc); };
+    JumpTarget resolve({loc, "resolve_clone"});
+    JumpTarget dispatch({loc, "dispatch_clone"});
+    branch(w.cmp(Cmp_lt, load_cache(), w.literal_qs32(0, loc), loc), resolve, dispatch, loc);
+    if (enter(resolve)) {
+        auto max_leaf = cpuid(*this, 0, loc)[0];
+        auto leaf1 = cpuid(*this, 1, loc);
+        auto leaf7 = cpuid(*this, 7, loc); // data of some other leaf if there is no leaf 7
+        auto has_leaf7 = w.cmp(Cmp_ge, max_leaf, w.literal_pu32(7, loc), loc);
+        for (auto& reg : leaf7)
+            reg = w.select(has_leaf7, reg, w.literal_pu32(0, loc), loc);
+
+        auto choose = [&] (const Def* xcr0) {
+            const Def* index = w.literal_qs32(0, loc);
+            for (size_t i = 0, e = features.size(); i != e; ++i)
+                index = w.select(supports(*this, features[i], leaf1, leaf7, xcr0, loc), w.literal_qs32(i + 1, loc), index, loc);
+            call_builtin(FnDecl::Intrinsic_atomic_store, {cache, index, relaxed}, nullptr, loc);
+            jump(dispatch, loc);
+        };
+
+        // xgetbv raises #UD unless the OS has enabled it
+        JumpTarget xsave({loc, "xsave"});
+        JumpTarget no_xsave({loc, "no_xsave"});
+        auto osxsave = w.arithop(ArithOp_and, leaf1[2], w.literal_pu32(1u << 27, loc), loc);
+        branch(w.cmp(Cmp_ne, osxsave, w.literal_pu32(0, loc), loc), xsave, no_xsave, loc);
+        if (enter(xsave))
+            choose(xgetbv(*this, loc));
+        if (enter(no_xsave))
+            choose(w.literal_pu32(0, loc));
+    }
+
+    enter(dispatch);
+    auto index = load_cache();
+    std::vector<const Def*> args(dispatcher->params().begin(), dispatcher->params().end());
+    for (size_t i = clones.size(); i-- != 1;) {
+        JumpTarget t({loc, "clone"});
+        JumpTarget f({loc, "next_clone"});
+        branch(w.cmp(Cmp_eq, index, w.literal_qs32(i, loc), loc), t, f, loc);
+        if (enter(t)) {
+            args.front() = get_mem();
+            cur_bb->jump(clones[i], args, loc);
+        }
+        enter(f);
+    }
+    args.front() = get_mem();
+    cur_bb->jump(clones.front(), args, loc);
+}
+
 /*
  * Decls and Function
  */
@@ -154,7 +529,7 @@ Value LocalDecl::emit(CodeGen& cg, const Def* init) const {
 
     if (is_mut()) {
         if (is_address_taken())
-            value_ = Value::create_ptr(cg, cg.world().slot(thorin_type, cg.frame(), debug()));
+            value_ = Value::create_ptr(cg, cg.world().slot(thorin_type, cg.frame(), aligned_debug(this, storage_align(cg.instantiate(type())))));
         else
             value_ = Value::create_mut(cg, handle(), thorin_type, symbol().str());
 
@@ -176,6 +551,7 @@ void Fn::emit_body(CodeGen& cg, Location location) const {
     continuation()->set_parent(cg.cur_bb);
     THORIN_PUSH(cg.cur_fn, this);
     THORIN_PUSH(cg.cur_bb, continuation());
+    THORIN_PUSH(cg.fast_math, cg.fast_math || is_fast_math());
 
     // setup memory + frame
     size_t i = 0;
@@ -187,8 +563,8 @@ void Fn::emit_body(CodeGen& cg, Location location) const {
     // name params and setup store locations
     for (const auto& param : params()) {
         auto p = continuation()->param(i++);
-        p->debug().set(param->symbol().str());
-        cg.emit(param.get(), p);
+        p->debug().set(param->symbol().str() + (param->is_noalias() ? noalias_marker : ""));
+        cg.emit_local(param.get(), cg.assume_aligned(p, ptr_align(cg.instantiate(param->type())), location));
     }
     assert(i == continuation()->num_params());
     if (continuation()->num_params() != 0 && continuation()->params().back()->type()->isa<thorin::FnType>())
@@ -218,21 +594,66 @@ void ValueItem::emit(CodeGen& cg) const {
     cg.emit(this, nullptr);
 }
 
+/**
+ * Roots of the emission: @c main, @c extern functions with a body, statics, extern blocks and impls.
+ * All other items are only emitted if they are reachable from a root.
+ * The methods of an impl are roots because they may be dispatched via the impl rather than named by a path.
+ */
+static bool is_root(const Item* item) {
+    if (auto fn_decl = item->isa<FnDecl>())
+        return (fn_decl->is_extern() && fn_decl->abi() == "") || fn_decl->symbol() == "main";
+    return !item->isa<StructDecl>(); // struct types are converted on demand
+}
+
 void Module::emit(CodeGen& cg) const {
-    for (const auto& item : items())
-        cg.emit(item.get());
+    // create all heads first such that bodies can refer to any function
+    for (const auto& item : items()) {
+        if (auto fn_decl = item->isa<FnDecl>()) {
+            cg.defer(fn_decl);
+            cg.emit(item.get());
+            if (is_root(fn_decl))
+                cg.enqueue(fn_decl);
+        }
+    }
+
+    for (const auto& item : items()) {
+        if (!item->isa<FnDecl>() && is_root(item.get()))
+            cg.emit(item.get());
+    }
+
+    cg.emit_bodies();
 }
 
-static bool is_primop(const Symbol& name) {
-    if      (name == "select")   return true;
-    else if (name == "sizeof")   return true;
-    else if (name == "bitcast")  return true;
-    return false;
+/// Intrinsics unknown to Thorin - they are emitted at each call, so their declarations get no continuation.
+static bool is_primop(FnDecl::Intrinsic intrinsic) {
+    switch (intrinsic) {
+        case FnDecl::Intrinsic_select:
+        case FnDecl::Intrinsic_sizeof:
+        case FnDecl::Intrinsic_bitcast:
+        case FnDecl::Intrinsic_shuffle:
+        case FnDecl::Intrinsic_broadcast:
+        case FnDecl::Intrinsic_hadd:
+        case FnDecl::Intrinsic_hmin:
+        case FnDecl::Intrinsic_hmax:
+        case FnDecl::Intrinsic_simd_lanes:
+        case FnDecl::Intrinsic_masked_load:
+        case FnDecl::Intrinsic_masked_store:
+        case FnDecl::Intrinsic_gather:
+        case FnDecl::Intrinsic_scatter:
+        case FnDecl::Intrinsic_assume_aligned:
+        case FnDecl::Intrinsic_fma:
+        case FnDecl::Intrinsic_rsqrt:
+        case FnDecl::Intrinsic_atomic_load:
+        case FnDecl::Intrinsic_atomic_store:
+        case FnDecl::Intrinsic_cmpxchg_weak:
+        case FnDecl::Intrinsic_fence:          return true;
+        default:                               return false;
+    }
 }
 
 Value FnDecl::emit(CodeGen& cg, const Def*) const {
     // no code is emitted for primops
-    if (is_extern() && abi() == "\"thorin\"" && is_primop(symbol()))
+    if (is_primop(intrinsic()))
         return value_;
 
     // create thorin function
@@ -245,8 +666,8 @@ Value FnDecl::emit(CodeGen& cg, const Def*) const {
         continuation()->make_external();
     }
 
-    if (body())
-        emit_body(cg, location());
+    if (body() && !cg.is_deferred(this))
+        cg.emit_body(this);
     return value_;
 }
 
@@ -270,24 +691,25 @@ void ImplItem::emit(CodeGen& cg) const {
     if (def_)
         return;
 
+    // the bodies are emitted once via the queue such that they may refer to all methods
     Array<const Def*> args(num_methods());
     for (size_t i = 0, e = args.size(); i != e; ++i) {
+        cg.defer(method(i));
         cg.emit(method(i), nullptr); // TODO use init
+        cg.enqueue(method(i));
         args[i] = method(i)->continuation();
     }
 
-    for (size_t i = 0, e = args.size(); i != e; ++i)
-        method(i)->emit_body(cg, location());
-
     def_ = cg.world().tuple(args, location());
 }
 
 Value StaticItem::emit(CodeGen& cg, const Def* init) const {
     assert(!init);
     init = !this->init() ? cg.world().bottom(cg.convert(type()), location()) : cg.remit(this->init());
-    if (!is_mut())
+    auto align = std::max(this->align(), storage_align(type()));
+    if (!is_mut() && align == 0)
         return Value::create_val(cg, init);
-    return Value::create_ptr(cg, cg.world().global(init, true, debug()));
+    return Value::create_ptr(cg, cg.world().global(init, is_mut(), aligned_debug(this, align)));
 }
 
 void StructDecl::emit(CodeGen& cg) const {
@@ -347,26 +769,48 @@ const Def* StrExpr::remit(CodeGen& cg) const {
 const Def* CastExpr::remit(CodeGen& cg) const {
     auto def = cg.remit(src());
     auto thorin_type = cg.convert(type());
+    // bf16 is converted via f32
+    if (cg.has_bf16_lanes(src()->type()))
+        def = cg.widen_bf16(def, location());
+    if (cg.has_bf16_lanes(type()))
+        return cg.narrow_to_bf16(cg.world().convert(cg.world().type_pf32(), def, location()), location());
+    // a cast to a pointer with a stronger align(N) annotation promises the alignment
+    auto align = ptr_align(cg.instantiate(type()));
+    if (align > ptr_align(cg.instantiate(src()->type())))
+        return cg.assume_aligned(cg.world().convert(thorin_type, def, location()), align, location());
     return cg.world().convert(thorin_type, def, location());
 }
 
 Value PathExpr::lemit(CodeGen& cg) const {
+    if (auto fn_decl = value_decl()->isa<FnDecl>())
+        cg.enqueue(fn_decl);
     return cg.emit(value_decl(), nullptr);
 }
 
+/// The literal 1 for @p def of Impala type @p type.
+static const Def* one(CodeGen& cg, const Def* def, const Type* type, Location loc) {
+    if (cg.has_bf16_lanes(type))
+        return cg.world().literal_pu16(bf16_from_float(1.0f), loc);
+    return cg.world().one(def->type(), loc);
+}
+
 const Def* PrefixExpr::remit(CodeGen& cg) const {
     switch (kind()) {
         case INC:
         case DEC: {
             auto var = cg.lemit(rhs());
             const Def* def = var.load(location());
-            const Def* one = cg.world().one(def->type(), location());
-            const Def* ndef = cg.world().arithop(Token::to_arithop((TokenKind) kind()), def, one, location());
+            const Def* ndef = cg.emit_binop(Token::to_arithop((TokenKind) kind()), def, one(cg, def, rhs()->type(), location()), rhs()->type(), location());
             var.store(ndef, location());
             return ndef;
         }
         case ADD: return cg.remit(rhs());
-        case SUB: return cg.world().arithop_minus(cg.remit(rhs()), location());
+        case SUB: {
+            auto def = cg.remit(rhs());
+            if (cg.has_bf16_lanes(rhs()->type()))
+                return cg.narrow_to_bf16(cg.world().arithop_minus(cg.widen_bf16(def, location()), location()), location());
+            return cg.world().arithop_minus(def, location());
+        }
         case NOT: return cg.world().arithop_not(cg.remit(rhs()), location());
         case TILDE: {
             auto def = cg.remit(rhs());
@@ -410,6 +854,82 @@ void PrefixExpr::emit_branch(CodeGen& cg, JumpTarget& t, JumpTarget& f) const {
         cg.branch(cg.remit(this), t, f, location().back());
 }
 
+/// @p scalar repeated in each of the @p num lanes of a vector.
+static const Def* broadcast(CodeGen& cg, const Def* scalar, size_t num, Location loc) {
+    Array<const Def*> lanes(num);
+    std::fill_n(lanes.begin(), lanes.size(), scalar);
+    return cg.world().vector(lanes, loc);
+}
+
+/// Broadcasts @p def of scalar type @p type if @p other_type is a simd type.
+static const Def* broadcast(CodeGen& cg, const Def* def, const Type* type, const Type* other_type, Location loc) {
+    if (auto simd_type = other_type->isa<SimdType>()) {
+        if (!type->isa<SimdType>())
+            return broadcast(cg, def, simd_type->dim(), loc);
+    }
+    return def;
+}
+
+/// @p scalar - repeated in each of the @p num lanes if @p num is greater than one.
+static const Def* splat(CodeGen& cg, const Def* scalar, size_t num, Location loc) {
+    return num == 1 ? scalar : broadcast(cg, scalar, num, loc);
+}
+
+const Def* CodeGen::widen_bf16(const Def* def, Location loc) {
+    auto n = def->type()->as<thorin::PrimType>()->length();
+    auto bits = world().convert(world().type(PrimType_pu32, n), def, loc);
+    bits = world().arithop(ArithOp_shl, bits, splat(*this, world().literal_pu32(16, loc), n, loc), loc);
+    return world().bitcast(world().type(PrimType_pf32, n), bits, loc);
+}
+
+/// The same rounding as @p bf16_from_float but without any branches.
+const Def* CodeGen::narrow_to_bf16(const Def* def, Location loc) {
+    auto& w = world();
+    auto n = def->type()->as<thorin::PrimType>()->length();
+    auto lit = [&] (uint32_t val) { return splat(*this, w.literal_pu32(val, loc), n, loc); };
+
+    auto bits  = w.bitcast(w.type(PrimType_pu32, n), def, loc);
+    auto upper = w.arithop(ArithOp_shr, bits, lit(16), loc);
+    auto bias  = w.arithop(ArithOp_add, w.arithop(ArithOp_and, upper, lit(1), loc), lit(0x7fff), loc);
+    auto round = w.arithop(ArithOp_shr, w.arithop(ArithOp_add, bits, bias, loc), lit(16), loc);
+    auto nan   = w.cmp(Cmp_gt, w.arithop(ArithOp_and, bits, lit(0x7fffffff), loc), lit(0x7f800000), loc);
+    auto res   = w.select(nan, w.arithop(ArithOp_or, upper, lit(0x40), loc), round, loc);
+    return w.convert(w.type(PrimType_pu16, n), res, loc);
+}
+
+/// The quick counterpart of the precise floating-point @p type - @c nullptr if @p type is no such type.
+static const thorin::Type* quick_type(World& world, const thorin::Type* type) {
+    if (auto prim_type = type->isa<thorin::PrimType>()) {
+        switch (prim_type->primtype_kind()) {
+            case PrimType_pf16: return world.type(PrimType_qf16, prim_type->length());
+            case PrimType_pf32: return world.type(PrimType_qf32, prim_type->length());
+            case PrimType_pf64: return world.type(PrimType_qf64, prim_type->length());
+            default:            break;
+        }
+    }
+    return nullptr;
+}
+
+/*
+ * bf16 operands are widened to f32 and the result is rounded back.
+ * Thorin's quick floating-point types permit reassociation, contraction and approximation;
+ * precise operands are bitcast to them and the result is bitcast back - no-ops in LLVM.
+ */
+const Def* CodeGen::emit_binop(int tag, const Def* lhs, const Def* rhs, const Type* type, Location loc, bool quick) {
+    if (has_bf16_lanes(type)) {
+        auto ldef = widen_bf16(lhs, loc);
+        auto def = emit_binop(tag, ldef, widen_bf16(rhs, loc), nullptr, loc, quick);
+        return def->type() == ldef->type() ? narrow_to_bf16(def, loc) : def; // comparisons yield bools
+    }
+
+    auto qtype = quick || fast_math ? quick_type(world(), lhs->type()) : nullptr;
+    if (qtype == nullptr)
+        return world().binop(tag, lhs, rhs, loc);
+
+    auto def = world().binop(tag, world().bitcast(qtype, lhs, loc), world().bitcast(qtype, rhs, loc), loc);
+    return def->type() == qtype ? world().bitcast(lhs->type(), def, loc) : def; // comparisons yield bools
+}
+
 void InfixExpr::emit_branch(CodeGen& cg, JumpTarget& t, JumpTarget& f) const {
     switch (kind()) {
         case ANDAND: {
@@ -433,6 +953,13 @@ void InfixExpr::emit_branch(CodeGen& cg, JumpTarget& t, JumpTarget& f) const {
 }
 
 const Def* InfixExpr::remit(CodeGen& cg) const {
+    if (type()->isa<SimdType>() && (kind() == ANDAND || kind() == OROR)) {
+        // masks are combined lane-wise without short-circuit evaluation
+        auto ldef = broadcast(cg, cg.remit(lhs()), lhs()->type(), rhs()->type(), location());
+        auto rdef = broadcast(cg, cg.remit(rhs()), rhs()->type(), lhs()->type(), location());
+        return cg.world().arithop(kind() == ANDAND ? ArithOp_and : ArithOp_or, ldef, rdef, location());
+    }
+
     switch (kind()) {
         case ANDAND: {
             JumpTarget t({lhs()->location().front(), "and_true"});
@@ -460,25 +987,25 @@ const Def* InfixExpr::remit(CodeGen& cg) const {
                 const Def* rdef = cg.remit(rhs());
 
                 if (op != Token::ASGN) {
+                    rdef = broadcast(cg, rdef, rhs()->type(), lhs()->type(), location());
                     TokenKind sop = Token::separate_assign(op);
-                    rdef = cg.world().binop(Token::to_binop(sop), lvar.load(location()), rdef, location());
+                    rdef = cg.emit_binop(Token::to_binop(sop), lvar.load(location()), rdef, lhs()->type(), location());
                 }
 
                 lvar.store(rdef, location());
                 return cg.world().tuple({}, location());
             }
 
-            const Def* ldef = cg.remit(lhs());
-            const Def* rdef = cg.remit(rhs());
-            return cg.world().binop(Token::to_binop(op), ldef, rdef, location());
+            const Def* ldef = broadcast(cg, cg.remit(lhs()), lhs()->type(), rhs()->type(), location());
+            const Def* rdef = broadcast(cg, cg.remit(rhs()), rhs()->type(), lhs()->type(), location());
+            return cg.emit_binop(Token::to_binop(op), ldef, rdef, lhs()->type(), location());
     }
 }
 
 const Def* PostfixExpr::remit(CodeGen& cg) const {
     Value var = cg.lemit(lhs());
     const Def* def = var.load(location());
-    const Def* one = cg.world().one(def->type(), location());
-    var.store(cg.world().arithop(Token::to_arithop((TokenKind) kind()), def, one, location()), location());
+    var.store(cg.emit_binop(Token::to_arithop((TokenKind) kind()), def, one(cg, def, lhs()->type(), location()), lhs()->type(), location()), location());
     return def;
 }
 
@@ -523,9 +1050,16 @@ const Def* StructExpr::remit(CodeGen& cg) const {
 
 Value TypeAppExpr::lemit(CodeGen&) const { THORIN_UNREACHABLE; }
 
-const Def* TypeAppExpr::remit(CodeGen& /*cg*/) const {
-    assert(false && "TODO");
-    THORIN_UNREACHABLE;
+const Def* TypeAppExpr::remit(CodeGen& cg) const {
+    auto path = lhs()->isa<PathExpr>();
+    auto fn_decl = path ? path->value_decl()->isa<FnDecl>() : nullptr;
+    if (fn_decl == nullptr || fn_decl->body() == nullptr || num_type_args() == 0)
+        return cg.remit(lhs());
+
+    std::vector<const Type*> type_args;
+    for (auto type_arg : this->type_args())
+        type_args.push_back(cg.instantiate(type_arg));
+    return cg.instantiate(fn_decl, std::move(type_args));
 }
 
 Value MapExpr::lemit(CodeGen& cg) const {
@@ -536,62 +1070,216 @@ Value MapExpr::lemit(CodeGen& cg) const {
 
 const Def* MapExpr::remit(CodeGen& cg) const { return remit(cg, None, Location()); }
 
+static const char* intrinsic_name(FnDecl::Intrinsic intrinsic) {
+    switch (intrinsic) {
+#define IMPALA_INTRINSIC(name) case FnDecl::Intrinsic_##name: return #name;
+#include "impala/intrinsiclist.h"
+        default: THORIN_UNREACHABLE;
+    }
+}
+
+/**
+ * Number of arguments of an atomic intrinsic including its trailing memory orderings.
+ * Orderings which are omitted in the declaration of the intrinsic default to @p SeqCst if the intrinsic is a builtin.
+ */
+static size_t num_atomic_args(FnDecl::Intrinsic intrinsic) {
+    switch (intrinsic) {
+        case FnDecl::Intrinsic_fence:        return 1;
+        case FnDecl::Intrinsic_atomic_load:  return 2;
+        case FnDecl::Intrinsic_atomic_store: return 3;
+        case FnDecl::Intrinsic_atomic:       return 4;
+        case FnDecl::Intrinsic_cmpxchg:
+        case FnDecl::Intrinsic_cmpxchg_weak: return 5;
+        default:                             return 0;
+    }
+}
+
+/**
+ * Whether the call is lowered by @p finish_llvm - see @p builtin_prefix.
+ * Thorin's own @c atomic and @c cmpxchg take no memory orderings; with orderings they are builtins as well.
+ */
+static bool is_builtin(FnDecl::Intrinsic intrinsic, size_t num_args) {
+    switch (intrinsic) {
+        case FnDecl::Intrinsic_atomic:
+        case FnDecl::Intrinsic_cmpxchg:      return num_args > 3;
+        case FnDecl::Intrinsic_atomic_load:
+        case FnDecl::Intrinsic_atomic_store:
+        case FnDecl::Intrinsic_cmpxchg_weak:
+        case FnDecl::Intrinsic_fence:        return true;
+        default:                             return false;
+    }
+}
+
+/// @p type mangled like the types of LLVM's overloaded intrinsics - e.g. @c v8f32 or @c p0i32.
+static std::string mangle(const thorin::Type* type) {
+    std::string result;
+    if (auto prim_type = type->isa<thorin::PrimType>()) {
+        switch (prim_type->primtype_kind()) {
+            case PrimType_bool: result = "i1"; break;
+            case PrimType_ps8:  case PrimType_pu8:  case PrimType_qs8:  case PrimType_qu8:  result = "i8";  break;
+            case PrimType_ps16: case PrimType_pu16: case PrimType_qs16: case PrimType_qu16: result = "i16"; break;
+            case PrimType_ps32: case PrimType_pu32: case PrimType_qs32: case PrimType_qu32: result = "i32"; break;
+            case PrimType_ps64: case PrimType_pu64: case PrimType_qs64: case PrimType_qu64: result = "i64"; break;
+            case PrimType_pf16: case PrimType_qf16: result = "f16"; break;
+            case PrimType_pf32: case PrimType_qf32: result = "f32"; break;
+            case PrimType_pf64: case PrimType_qf64: result = "f64"; break;
+            default: THORIN_UNREACHABLE;
+        }
+    } else if (auto ptr_type = type->isa<thorin::PtrType>()) {
+        result = "p" + std::to_string(int(ptr_type->addr_space())) + mangle(ptr_type->referenced_type());
+    } else
+        return "t" + std::to_string(type->gid()); // only needs to be unique
+    auto length = type->as<thorin::VectorType>()->length();
+    return length > 1 ? "v" + std::to_string(length) + result : result;
+}
+
+/// The name of the LLVM intrinsic @c llvm.<name> overloaded for @p type - e.g. @c llvm.fma.v8f32.
+static std::string llvm_intrinsic(const char* name, const thorin::Type* type) {
+    return std::string("llvm.") + name + "." + mangle(type);
+}
+
+/// The name of the builtin for @p intrinsic of type @p fn_type - overloaded for the types of its parameters.
+static std::string builtin_name(const char* intrinsic, const thorin::FnType* fn_type) {
+    std::string result = builtin_prefix + std::string(intrinsic);
+    for (size_t i = 1, e = fn_type->num_ops() - 1; i < e; ++i) // without mem and return continuation
+        result += "." + mangle(fn_type->op(i));
+    return result;
+}
+
+const Def* CodeGen::call_builtin(FnDecl::Intrinsic intrinsic, ArrayRef<const Def*> args, const thorin::Type* ret_type, Location loc) {
+    auto& w = world();
+    std::vector<const thorin::Type*> types = {w.mem_type()};
+    std::vector<const Def*> defs = {get_mem()};
+    for (auto arg : args) {
+        types.push_back(arg->type());
+        defs.push_back(arg);
+    }
+    types.push_back(ret_type ? w.fn_type({w.mem_type(), ret_type}) : w.fn_type({w.mem_type()}));
+    auto fn_type = w.fn_type(types);
+    auto name = intrinsic_name(intrinsic);
+    auto ret = call(import(builtin_name(name, fn_type), fn_type, loc), defs, ret_type ? ret_type : w.tuple_type({}),
+                    {loc, std::string(name) + "_cont"});
+    set_mem(cur_bb->param(0));
+    return ret;
+}
+
+/// Lane @c i of the result is lane @c mask[i] of the concatenation of @p a and @p b - a @c shufflevector in LLVM.
+static const Def* shuffle(CodeGen& cg, const Def* a, const Def* b, const SimdExpr* mask, Location loc) {
+    auto& w = cg.world();
+    Array<const Def*> indices(mask->num_args());
+    for (size_t i = 0, e = mask->num_args(); i != e; ++i)
+        indices[i] = w.literal_pu32(mask->arg(i)->as<LiteralExpr>()->get_u64(), loc);
+    return cg.call_builtin(FnDecl::Intrinsic_shuffle, {a, b, w.vector(indices, loc)}, a->type(), loc);
+}
+
+/// Horizontal add/min/max of @p vec - one of LLVM's @c llvm.vector.reduce intrinsics; @p is_signed selects the integer min/max.
+static const Def* reduce_lanes(CodeGen& cg, FnDecl::Intrinsic intrinsic, const Def* vec, bool is_signed, Location loc) {
+    auto elem_type = cg.extract(vec, uint32_t(0), loc)->type();
+    return cg.call_builtin(intrinsic, {vec, cg.world().literal_bool(is_signed, loc)}, elem_type, loc);
+}
+
+/**
+ * Masked loads/stores and gathers/scatters - LLVM's @c llvm.masked intrinsics, so only enabled lanes touch memory.
+ * @p indices is @c nullptr for @c masked_load and @c masked_store; @p vec is the passthru or the stored vector.
+ */
+static const Def* masked_access(CodeGen& cg, FnDecl::Intrinsic intrinsic, const Def* ptr, const Def* indices,
+                                const Def* mask, const Def* vec, Location loc) {
+    bool is_load = intrinsic == FnDecl::Intrinsic_masked_load || intrinsic == FnDecl::Intrinsic_gather;
+    std::vector<const Def*> args = {ptr};
+    if (indices)
+        args.push_back(indices);
+    args.push_back(mask);
+    args.push_back(vec);
+    auto result = cg.call_builtin(intrinsic, args, is_load ? vec->type() : nullptr, loc);
+    return is_load ? result : cg.world().tuple({}, loc);
+}
+
 const Def* MapExpr::remit(CodeGen& cg, State state, Location eval_loc) const {
     if (auto fn_type = lhs()->type()->isa<FnType>()) {
-        const Def* dst = nullptr;
+        auto intrinsic = FnDecl::NoIntrinsic;
 
         // Handle primops here
-        if (auto type_expr = lhs()->isa<TypeAppExpr>()) { // Bitcast, sizeof and select are all polymorphic
-            if (auto path = type_expr->lhs()->isa<PathExpr>()) {
-                if (auto fn_decl = path->value_decl()->isa<FnDecl>()) {
-                    if (fn_decl->is_extern() && fn_decl->abi() == "\"thorin\"") {
-                        auto name = fn_decl->fn_symbol().remove_quotation();
-                        if (name == "bitcast") {
-                            return cg.world().bitcast(cg.convert(type_expr->type_arg(0)), cg.remit(arg(0)), eval_loc);
-                        } else if (name == "select") {
-                            return cg.world().select(cg.remit(arg(0)), cg.remit(arg(1)), cg.remit(arg(2)), eval_loc);
-                        } else if (name == "sizeof") {
-                            return cg.world().size_of(cg.convert(type_expr->type_arg(0)), eval_loc);
-                        } else if (name == "reserve_shared") {
-                            auto ptr_type = cg.convert(type());
-                            auto fn_type = cg.world().fn_type({
-                                cg.world().mem_type(), cg.world().type_qs32(),
-                                cg.world().fn_type({ cg.world().mem_type(), ptr_type }) });
-                            auto cont = cg.world().continuation(fn_type, {location(), "reserve_shared"});
-                            cont->set_intrinsic();
-                            dst = cont;
-                        } else if (name == "atomic") {
-                            auto poly_type = cg.convert(type());
-                            auto ptr_type = cg.convert(arg(1)->type());
-                            auto fn_type = cg.world().fn_type({
-                                cg.world().mem_type(), cg.world().type_pu32(), ptr_type, poly_type,
-                                cg.world().fn_type({ cg.world().mem_type(), poly_type }) });
-                            auto cont = cg.world().continuation(fn_type, {location(), "atomic"});
-                            cont->set_intrinsic();
-                            dst = cont;
-                        } else if (name == "cmpxchg") {
-                            auto ptr_type = cg.convert(arg(0)->type());
-                            auto poly_type = ptr_type->as<thorin::PtrType>()->referenced_type();
-                            auto fn_type = cg.world().fn_type({
-                                cg.world().mem_type(), ptr_type, poly_type, poly_type,
-                                cg.world().fn_type({ cg.world().mem_type(), poly_type, cg.world().type_bool() }) });
-                            auto cont = cg.world().continuation(fn_type, {location(), "cmpxchg"});
-                            cont->set_intrinsic();
-                            dst = cont;
+        auto type_expr = lhs()->isa<TypeAppExpr>(); // Bitcast, sizeof and select are all polymorphic
+        if (auto path = (type_expr ? type_expr->lhs() : lhs())->isa<PathExpr>()) {
+            if (auto fn_decl = path->value_decl()->isa<FnDecl>()) {
+                intrinsic = fn_decl->intrinsic();
+                switch (intrinsic) {
+                    case FnDecl::Intrinsic_bitcast:
+                        return cg.world().bitcast(cg.convert(type_expr->type_arg(0)), cg.remit(arg(0)), eval_loc);
+                    case FnDecl::Intrinsic_select:
+                        return cg.world().select(cg.remit(arg(0)), cg.remit(arg(1)), cg.remit(arg(2)), eval_loc);
+                    case FnDecl::Intrinsic_sizeof:
+                        return cg.world().size_of(cg.convert(type_expr->type_arg(0)), eval_loc);
+                    case FnDecl::Intrinsic_shuffle:
+                        return shuffle(cg, cg.remit(arg(0)), cg.remit(arg(1)), arg(2)->as<SimdExpr>(), location());
+                    case FnDecl::Intrinsic_broadcast:
+                        return broadcast(cg, cg.remit(arg(0)), cg.convert(type())->as<thorin::VectorType>()->length(), location());
+                    case FnDecl::Intrinsic_hadd:
+                    case FnDecl::Intrinsic_hmin:
+                    case FnDecl::Intrinsic_hmax:
+                    {
+                        bool is_signed = is_i8(type()) || is_i16(type()) || is_i32(type()) || is_i64(type());
+                        if (cg.has_bf16_lanes(type())) {
+                            auto vec = cg.widen_bf16(cg.remit(arg(0)), location());
+                            return cg.narrow_to_bf16(reduce_lanes(cg, intrinsic, vec, false, location()), location());
                         }
+                        return reduce_lanes(cg, intrinsic, cg.remit(arg(0)), is_signed, location());
+                    }
+                    case FnDecl::Intrinsic_simd_lanes:
+                        return cg.world().literal_qs32(cg.convert(type_expr->type_arg(0))->as<thorin::VectorType>()->length(), eval_loc);
+                    case FnDecl::Intrinsic_masked_load:
+                    case FnDecl::Intrinsic_masked_store: {
+                        auto ptr = cg.remit(arg(0));
+                        auto mask = cg.remit(arg(1));
+                        return masked_access(cg, intrinsic, ptr, nullptr, mask, cg.remit(arg(2)), location());
+                    }
+                    case FnDecl::Intrinsic_gather:
+                    case FnDecl::Intrinsic_scatter: {
+                        auto ptr = cg.remit(arg(0));
+                        auto indices = cg.remit(arg(1));
+                        auto mask = cg.remit(arg(2));
+                        return masked_access(cg, intrinsic, ptr, indices, mask, cg.remit(arg(3)), location());
                     }
+                    case FnDecl::Intrinsic_assume_aligned:
+                        return cg.assume_aligned(cg.remit(arg(0)), arg(1)->as<LiteralExpr>()->get_u64(), location());
+                    default:
+                        break;
                 }
             }
         }
 
-        dst = dst ? dst : cg.remit(lhs());
+        // the remaining intrinsics get a fresh continuation whose type is derived from the actual arguments
+        const Def* dst = intrinsic == FnDecl::NoIntrinsic ? cg.remit(lhs()) : nullptr;
 
         std::vector<const Def*> defs;
         defs.push_back(nullptr); // reserve for mem but set later - some other args may update the monad
         for (const auto& arg : args())
             defs.push_back(cg.remit(arg.get()));
+        bool builtin = is_builtin(intrinsic, num_args());
+        for (size_t i = num_args(), e = num_atomic_args(intrinsic); builtin && i < e; ++i)
+            defs.push_back(cg.world().literal_pu32(SeqCst, location()));
         defs.front() = cg.get_mem(); // now get the current memory monad
 
+        if (dst == nullptr) {
+            assert(num_args() < fn_type->num_ops());
+            std::vector<const thorin::Type*> types;
+            for (auto def : defs)
+                types.push_back(def->type());
+            types.push_back(cg.convert(fn_type->op(fn_type->num_ops()-1)));
+            auto fn_type = cg.world().fn_type(types);
+            if (intrinsic == FnDecl::Intrinsic_fma) {
+                dst = cg.import(llvm_intrinsic("fma", types[1]), fn_type, location());
+            } else if (intrinsic == FnDecl::Intrinsic_rsqrt) {
+                dst = cg.import(llvm_intrinsic("sqrt", types[1]), fn_type, location());
+            } else if (builtin) {
+                dst = cg.import(builtin_name(intrinsic_name(intrinsic), fn_type), fn_type, location());
+            } else {
+                auto cont = cg.world().continuation(fn_type, {location(), intrinsic_name(intrinsic)});
+                cont->set_intrinsic();
+                dst = cont;
+            }
+        }
+
         auto ret_type = args().size() == fn_type->num_ops() ? nullptr : cg.convert(fn_type->return_type());
         auto old_bb = cg.cur_bb;
         auto ret = cg.call(dst, defs, ret_type, thorin::Debug(location(), dst->name()) + "_cont");
@@ -602,6 +1290,19 @@ const Def* MapExpr::remit(CodeGen& cg, State state, Location eval_loc) const {
             auto eval = state == Run ? &thorin::World::run : &thorin::World::hlt;
             auto cont = old_bb->args().back();
             old_bb->update_callee((cg.world().*eval)(old_bb->callee(), cont, eval_loc));
+            if (state == Run)
+                cg.add_run(old_bb, eval_loc, false);
+        } else if (intrinsic == FnDecl::NoIntrinsic) {
+            cg.add_call(old_bb, location());
+        }
+
+        if (intrinsic == FnDecl::Intrinsic_rsqrt) {
+            // a quick division lets LLVM turn 1 / sqrt(x) into an estimate plus refinement
+            auto prim_type = ret->type()->as<thorin::PrimType>();
+            const Def* one = cg.world().one(cg.world().type(prim_type->primtype_kind()), location());
+            if (prim_type->length() > 1)
+                one = broadcast(cg, one, prim_type->length(), location());
+            ret = cg.emit_binop(ArithOp_div, one, ret, type(), location(), /*quick*/ true);
         }
 
         return ret;
@@ -622,6 +1323,12 @@ const Def* FieldExpr::remit(CodeGen& cg) const {
 }
 
 const Def* BlockExprBase::remit(CodeGen& cg) const {
+    THORIN_PUSH(cg.fast_math, cg.fast_math || is_fast_math());
+    // nested items are visible in the whole block - reset all of them before any statement may refer to one
+    for (const auto& stmt : stmts()) {
+        if (auto item_stmt = stmt->isa<ItemStmt>())
+            cg.reset(item_stmt->item());
+    }
     for (const auto& stmt : stmts())
         cg.emit(stmt.get());
     return cg.remit(expr());
@@ -641,6 +1348,7 @@ const Def* RunBlockExpr::remit(CodeGen& cg) const {
             cg.cur_bb->jump(next, {}, location());
             cg.enter(next);
             old_bb->update_callee(w.run(lrun, next, location()));
+            cg.add_run(old_bb, location(), true);
             return res;
         }
 
@@ -691,10 +1399,95 @@ void WhileExpr::emit_jump(CodeGen& cg, JumpTarget& exit_bb) const {
     cg.enter(exit_bb);
 }
 
-const Def* ForExpr::remit(CodeGen& cg) const {
-    std::vector<const Def*> defs;
-    defs.push_back(nullptr); // reserve for mem but set later - some other args may update the monad
+static bool is_param(const Expr* expr, const Param* param) {
+    auto path = expr->isa<PathExpr>();
+    return path && path->value_decl() == param;
+}
+
+/// Flattens the statements and the trailing expression of @p expr if it is a @p BlockExpr; nullptr marks other @p Stmt%s.
+static std::vector<const Expr*> flatten(const Expr* expr) {
+    std::vector<const Expr*> result;
+    if (auto block = expr->isa<BlockExpr>()) {
+        for (const auto& stmt : block->stmts()) {
+            auto expr_stmt = stmt->isa<ExprStmt>();
+            result.push_back(expr_stmt ? expr_stmt->expr() : nullptr);
+        }
+        if (!block->expr()->isa<EmptyExpr>())
+            result.push_back(block->expr());
+    } else
+        result.push_back(expr);
+    return result;
+}
+
+/**
+ * Matches a range-style iterator like
+@code{.cpp}
+fn range(a: int, b: int, body: fn(int) -> ()) -> () {
+    if a < b {
+        body(a);
+        range(a+1, b, body, return)
+    }
+}
+@endcode
+ * The comparison may be any comparison operator and the step any literal which is added to or subtracted from @c a.
+ * On success, @p cond and @p step are set to the comparison and step expression.
+ */
+static bool is_range(const FnDecl* fn_decl, const InfixExpr*& cond, const InfixExpr*& step) {
+    if (fn_decl->num_ast_type_params() != 0 || fn_decl->num_params() != 4 || fn_decl->body() == nullptr)
+        return false;
+
+    auto a = fn_decl->param(0), b = fn_decl->param(1), body = fn_decl->param(2), ret = fn_decl->param(3);
+    if (a->is_mut() || b->is_mut() || !is_int(a->type()) || a->type() != b->type() || !body->type()->isa<FnType>())
+        return false;
+
+    auto outer = flatten(fn_decl->body());
+    auto if_expr = outer.size() == 1 && outer.front() ? outer.front()->isa<IfExpr>() : nullptr;
+    if (if_expr == nullptr)
+        return false;
+
+    cond = if_expr->cond()->isa<InfixExpr>();
+    if (cond == nullptr || !is_param(cond->lhs(), a) || !is_param(cond->rhs(), b))
+        return false;
+    switch (cond->kind()) {
+        case InfixExpr::EQ: case InfixExpr::NE:
+        case InfixExpr::LT: case InfixExpr::LE:
+        case InfixExpr::GT: case InfixExpr::GE: break;
+        default: return false;
+    }
 
+    // else branch must not do anything but returning
+    for (auto expr : flatten(if_expr->else_expr())) {
+        if (expr && expr->isa<EmptyExpr>())
+            continue;
+        auto ret_call = expr ? expr->isa<MapExpr>() : nullptr;
+        if (ret_call == nullptr || !is_param(ret_call->lhs(), ret) || ret_call->num_args() != 0)
+            return false;
+    }
+
+    auto then_exprs = flatten(if_expr->then_expr());
+    if (then_exprs.size() != 2 || !then_exprs[0] || !then_exprs[1])
+        return false;
+
+    // body(a)
+    auto body_call = then_exprs[0]->isa<MapExpr>();
+    if (body_call == nullptr || !is_param(body_call->lhs(), body) || body_call->num_args() != 1 || !is_param(body_call->arg(0), a))
+        return false;
+
+    // range(a + step, b, body, return) - passing the return continuation explicitly is optional
+    auto rec_call = then_exprs[1]->isa<MapExpr>();
+    if (rec_call == nullptr || rec_call->num_args() < 3 || rec_call->num_args() > 4)
+        return false;
+    auto callee = rec_call->lhs()->isa<PathExpr>();
+    if (callee == nullptr || callee->value_decl() != fn_decl || !is_param(rec_call->arg(1), b) || !is_param(rec_call->arg(2), body)
+            || (rec_call->num_args() == 4 && !is_param(rec_call->arg(3), ret)))
+        return false;
+
+    step = rec_call->arg(0)->isa<InfixExpr>();
+    return step != nullptr && (step->kind() == InfixExpr::ADD || step->kind() == InfixExpr::SUB)
+        && is_param(step->lhs(), a) && step->rhs()->isa<LiteralExpr>();
+}
+
+const Def* ForExpr::remit(CodeGen& cg) const {
     auto break_continuation = cg.create_continuation(break_decl());
 
     // peel off run and halt
@@ -703,18 +1496,55 @@ const Def* ForExpr::remit(CodeGen& cg) const {
     if (prefix && (prefix->kind() == PrefixExpr::RUN || prefix->kind() == PrefixExpr::HLT))
         forexpr = prefix->rhs();
 
-    // emit call
     auto map_expr = forexpr->as<MapExpr>();
-    for (const auto& arg : map_expr->args())
-        defs.push_back(cg.remit(arg.get()));
-    defs.push_back(cg.remit(fn_expr()));
-    defs.push_back(break_continuation);
-    auto fun = cg.remit(map_expr->lhs());
-    if (prefix && prefix->kind() == PrefixExpr::RUN) fun = cg.world().run(fun, break_continuation, location());
-    if (prefix && prefix->kind() == PrefixExpr::HLT) fun = cg.world().hlt(fun, break_continuation, location());
+    auto path = map_expr->lhs()->isa<PathExpr>();
+    auto fn_decl = path ? path->value_decl()->isa<FnDecl>() : nullptr;
+    const InfixExpr* cond;
+    const InfixExpr* step;
+
+    if (forexpr == expr() && map_expr->num_args() == 2 && fn_decl && is_range(fn_decl, cond, step)) {
+        // emit a loop instead of relying on partial evaluation to get rid of the closure:
+        // head(mem, i): if i < upper { body(mem, i, next) } else { break(mem) } with next(mem): head(mem, i + step)
+        auto& w = cg.world();
+        auto lower = cg.remit(map_expr->arg(0));
+        auto upper = cg.remit(map_expr->arg(1));
+        auto body = cg.remit(fn_expr());
+        auto head = w.continuation(w.fn_type({w.mem_type(), lower->type()}), {location(), "for_head"});
+        auto next = w.continuation(w.fn_type({w.mem_type()}), {location(), "for_next"});
+        auto loop = w.basicblock({location(), "for_body"});
+        auto exit = w.basicblock({location(), "for_exit"});
+        auto mem = head->param(0);
+        auto i = head->param(1);
+        mem->debug().set("mem");
+        i->debug().set(fn_expr()->param(0)->symbol().str());
+
+        cg.cur_bb->jump(head, {cg.get_mem(), lower}, location());
+        head->branch(w.binop(Token::to_binop((TokenKind) cond->kind()), i, upper, cond->location()), loop, exit, location());
+        loop->jump(body, {mem, i, next}, location());
+        auto inc = w.binop(Token::to_binop((TokenKind) step->kind()), i, cg.remit(step->rhs()), step->location());
+        next->jump(head, {next->param(0), inc}, location());
+        exit->jump(break_continuation, {mem}, location());
+    } else {
+        std::vector<const Def*> defs;
+        defs.push_back(nullptr); // reserve for mem but set later - some other args may update the monad
+
+        // emit call
+        for (const auto& arg : map_expr->args())
+            defs.push_back(cg.remit(arg.get()));
+        defs.push_back(cg.remit(fn_expr()));
+        defs.push_back(break_continuation);
+        auto fun = cg.remit(map_expr->lhs());
+        if (prefix && prefix->kind() == PrefixExpr::RUN) fun = cg.world().run(fun, break_continuation, location());
+        if (prefix && prefix->kind() == PrefixExpr::HLT) fun = cg.world().hlt(fun, break_continuation, location());
 
-    defs.front() = cg.get_mem(); // now get the current memory monad
-    cg.call(fun, defs, nullptr, map_expr->location());
+        defs.front() = cg.get_mem(); // now get the current memory monad
+        auto old_bb = cg.cur_bb;
+        cg.call(fun, defs, nullptr, map_expr->location());
+        if (prefix && prefix->kind() == PrefixExpr::RUN)
+            cg.add_run(old_bb, location(), false);
+        else if (prefix == nullptr)
+            cg.add_call(old_bb, location());
+    }
 
     cg.set_continuation(break_continuation);
     if (break_continuation->num_params() == 2)
@@ -729,6 +1559,8 @@ const Def* ForExpr::remit(CodeGen& cg) const {
 
 const Def* FnExpr::remit(CodeGen& cg) const {
     auto continuation = emit_head(cg, location());
+    if (cg.options.closure_report)
+        cg.options.closure_report->add(location());
     emit_body(cg, location());
     return continuation;
 }
@@ -739,7 +1571,7 @@ const Def* FnExpr::remit(CodeGen& cg) const {
 
 void IdPtrn::emit(CodeGen& cg, const thorin::Def* init) const {
     init->debug().set(local()->symbol().str());
-    cg.emit(local(), init);
+    cg.emit_local(local(), init);
 }
 
 void TuplePtrn::emit(CodeGen& cg, const thorin::Def* init) const {
@@ -795,9 +1627,188 @@ void AsmStmt::emit(CodeGen& cg) const {
 
 //------------------------------------------------------------------------------
 
-void emit(World& world, const Module* mod) {
-    CodeGen cg(world);
+static bool is_recursive(const Scope& scope, Continuation* entry) {
+    for (auto use : entry->uses()) {
+        if (scope.contains(use.def()))
+            return true;
+    }
+    return false;
+}
+
+/// Does @p caller pass a literal or a function to its callee? The memory and the return continuation do not count.
+static bool has_static_arg(Continuation* caller) {
+    for (size_t i = 1, e = caller->num_args(); i + 1 < e; ++i) {
+        auto arg = caller->arg(i);
+        if (arg->isa_continuation() || is_const(arg))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Implements @c -auto-pe: a plain call is wrapped in a @c run as if it was annotated with @c @ if its callee consists of
+ * at most @p options.auto_pe_size defs and if it passes a function or a literal.
+ * Literals are ignored for recursive callees as specializing them usually unrolls the recursion without bound.
+ */
+void CodeGen::mark_runs() {
+    for (const auto& call : calls_) {
+        auto callee = call.caller->callee()->isa_continuation();
+        if (callee == nullptr || callee->empty())
+            continue;
+
+        Scope scope(callee);
+        if (scope.defs().size() > options.auto_pe_size)
+            continue;
+
+        bool recursive = is_recursive(scope, callee);
+        bool is_static = false;
+        for (size_t i = 1, e = call.caller->num_args(); i + 1 < e; ++i) {
+            auto arg = call.caller->arg(i);
+            is_static |= arg->isa_continuation() || (!recursive && is_const(arg));
+        }
+
+        if (is_static) {
+            call.caller->update_callee(world().run(callee, call.caller->args().back(), call.location));
+            run_sites_.push_back(call);
+        }
+    }
+}
+
+/**
+ * A chain of @p depth copies of the recursive @p callee: the recursive calls of each copy go to the next copy and those
+ * of the last copy go to @p callee itself behind a @c hlt.
+ * Thus the partial evaluator unfolds the recursion at most @p depth times even if the static arguments never reach a
+ * base case - as in <tt>@f(n, 0)</tt> with a dynamic @c n - and leaves a residual call to @p callee then.
+ * The copies which the partial evaluator does not reach stay unreferenced, so the cleanup removes them again.
+ */
+std::vector<Continuation*> CodeGen::unfold(Continuation* callee, size_t depth, Location location) {
+    std::vector<Continuation*> copies;
+    for (size_t i = 0; i != depth; ++i)
+        copies.push_back(thorin::clone(Scope(callee)));
+
+    for (size_t i = 0; i != depth; ++i) {
+        Scope scope(copies[i]);
+        for (auto def : scope.defs()) {
+            auto continuation = def->isa_continuation();
+            if (continuation == nullptr || (continuation->callee() != callee && continuation->callee() != copies[i]))
+                continue;
+            if (i + 1 != depth)
+                continuation->update_callee(copies[i + 1]);
+            else
+                continuation->update_callee(world().hlt(callee, continuation->args().back(), location));
+        }
+    }
+    return copies;
+}
+
+/**
+ * Guards the partial evaluator against mistaken @c @ annotations.
+ * A @c run is removed again - leaving a residual call - if it targets a recursive function without any static argument,
+ * as specializing such a call would probably not terminate, or if the callee exceeds the budget in @p options.
+ * Otherwise a recursive callee is unfolded at most as often as the budget per site allows - see @p unfold.
+ * The size of a specialization is estimated by the number of defs in the scope of the callee; a site is charged this
+ * size once, as the copies of an unfolded callee only grow the program if the partial evaluator actually reaches them.
+ * Each site is recorded in @p options.pe_report if requested.
+ */
+void CodeGen::check_runs() {
+    size_t total = 0;
+    for (const auto& run : run_sites_) {
+        auto eval = run.caller->callee()->isa<thorin::Run>();
+        if (eval == nullptr)
+            continue;
+        auto callee = eval->begin()->isa_continuation();
+        if (callee == nullptr || callee->empty())
+            continue;
+
+        Scope scope(callee);
+        size_t size = scope.defs().size();
+        size_t left = options.pe_budget - std::min(total, options.pe_budget);
+        bool recursive = !run.is_block && is_recursive(scope, callee);
+        std::string residual;
+        std::vector<Continuation*> copies;
+        if (recursive && !has_static_arg(run.caller)) {
+            warning(run.location, "'@' on recursive function '%' without static arguments may not terminate; emitting residual call", callee->name());
+            residual = "recursive without static arguments";
+        } else if (size > options.pe_site_budget) {
+            warning(run.location, "specializing '%' exceeds the partial evaluation budget per call site (% > %); emitting residual call",
+                    callee->name(), size, options.pe_site_budget);
+            residual = "exceeds -pe-site-budget";
+        } else if (size > left) {
+            warning(run.location, "partial evaluation budget of % exceeded; emitting residual call to '%'", options.pe_budget, callee->name());
+            residual = "exceeds -pe-budget";
+        } else {
+            if (recursive) {
+                copies = unfold(callee, options.pe_site_budget / size, run.location);
+                run.caller->update_callee(world().run(copies.front(), run.caller->args().back(), run.location));
+            }
+            total += size;
+        }
+
+        if (options.pe_report)
+            report_run(run, callee, size, residual, copies);
+        if (!residual.empty())
+            run.caller->update_callee(eval->begin());
+    }
+}
+
+void CodeGen::report_run(const RunSite& run, Continuation* callee, size_t size, const std::string& residual,
+                         const std::vector<Continuation*>& copies) {
+    PEReport::Site site;
+    std::ostringstream location, callee_location;
+    location << run.location;
+    callee_location << callee->location();
+    site.location = location.str();
+    site.is_block = run.is_block;
+    site.is_auto = run.is_auto;
+    site.callee = callee->name();
+    site.callee_location = callee_location.str();
+    site.callee_gid = callee->gid();
+    if (!run.is_block) {
+        for (size_t i = 1, e = run.caller->num_args(); i + 1 < e; ++i) {
+            auto arg = run.caller->arg(i);
+            site.static_args.push_back(arg->isa_continuation() || is_const(arg));
+        }
+    }
+    site.size_before = size;
+    site.residual = residual;
+    for (auto copy : copies)
+        site.copy_gids.push_back(copy->gid());
+    options.pe_report->add(std::move(site));
+}
+
+static double milliseconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*
+ * Emission is strictly serial; there are several reasons why function bodies cannot be emitted concurrently:
+ * - The @p World hash-conses all types and primops in unsynchronized tables and hands out gids from a single counter.
+ *   Even pure lookups like World::literal may insert.
+ *   @p IRBuilder and @p Continuation (set_value/get_value, seal) mutate the shared def-use graph.
+ * - @p CodeGen caches converted types in @p impala2thorin_ and owns the body queue.
+ * - The AST itself is used as scratch space: Decl::value_, Fn::continuation_/frame_/ret_param_ and ImplItem::def_ are
+ *   mutable fields which are written while emitting.
+ * A concurrent mode would therefore need one @p World plus one @p CodeGen per thread, a copy of the mutable AST state
+ * per thread, and a linker which imports defs of one @p World into another.
+ * Functions that cross such a boundary must become external on both sides.
+ * This is only sound for first-order functions, and it prevents any partial evaluation across the boundary.
+ * Thorin does not offer such a linker at the moment.
+ */
+void emit(World& world, const Module* mod, const EmitOptions& options) {
+    CodeGen cg(world, options);
+    auto start = std::chrono::steady_clock::now();
     mod->emit(cg);
+    DLOG("emitted % of % function bodies", cg.enqueued_.size(), cg.deferred_.size());
+    DLOG("emitted % instances of polymorphic functions for % instantiations", cg.instances_.size(), cg.num_instantiations_);
+    if (auto report = options.emission_report) {
+        report->num_bodies = cg.deferred_.size();
+        report->num_emitted = cg.enqueued_.size();
+        report->num_instances = cg.instances_.size();
+        report->num_instantiations = cg.num_instantiations_;
+        report->milliseconds = milliseconds_since(start);
+    }
+    cg.mark_runs();
+    cg.check_runs();
     clear_value_numbering_table(world);
 }
 
@@ -11,13 +11,22 @@ bool fancy_output = false;
 
 bool& fancy() { return fancy_output; }
 
+size_t& native_simd_width() {
+    static size_t width = simd_width(Target());
+    return width;
+}
+
 void init() { PrecTable::init(); Token::init(); }
 void destroy() { Symbol::destroy(); }
 void check(Init& init, const Module* mod, bool nossa) {
     name_analysis(mod);
+    log_allocs("name analysis");
     type_inference(init, mod);
+    log_allocs("type inference");
     type_analysis(mod, nossa);
-    //borrow_check(mod);
+    log_allocs("type analysis");
+    if (num_errors() == 0)
+        borrow_check(mod);
 }
 
 int global_num_warnings = 0;
@@ -26,6 +35,19 @@ int global_num_errors = 0;
 int num_warnings() { return global_num_warnings; }
 int num_errors() { return global_num_errors; }
 
+size_t global_num_allocs = 0;
+
+void log_allocs(const char* phase) {
+#ifdef IMPALA_COUNT_ALLOCS
+    static size_t last = 0;
+    size_t num = global_num_allocs - last;
+    std::cerr << "allocations during " << phase << ": " << num << std::endl;
+    last = global_num_allocs;
+#else
+    (void) phase;
+#endif
+}
+
 Type2Prec PrecTable::prefix_r;
 Type2Prec PrecTable::infix_l;
 Type2Prec PrecTable::infix_r;
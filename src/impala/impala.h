@@ -9,16 +9,22 @@
 #include "thorin/world.h"
 #include "thorin/util/stream.h"
 
+#include "impala/target.h"
 #include "impala/token.h"
 #include "impala/sema/typetable.h"
 
 namespace impala {
 
 bool& fancy();
+/// Width of the target's vector registers in bits - determines the number of lanes of @c simd[T * native].
+/// The driver sets it according to @c -target-cpu and @c -target-features; LLVM's default target has 128 bits.
+size_t& native_simd_width();
 
 class ASTNode;
 class Item;
+class ClosureReport;
 class Module;
+class PEReport;
 typedef std::vector<std::unique_ptr<const Item>> Items;
 
 void init();
@@ -40,9 +46,46 @@ void parse(Items&, std::istream&, const char*);
 void name_analysis(const Module*);
 void type_inference(Init&, const Module*);
 void type_analysis(const Module*, bool nossa);
-//void borrow_check(const ModContents*);
+/// Rejects conflicting @c &mut arguments and marks the @c &mut parameters proven not to alias - see @p Param::is_noalias.
+void borrow_check(const Module*);
 void check(Init&, const Module*, bool nossa);
-void emit(thorin::World&, const Module*);
+
+/// How many function bodies the lazy emission skipped - for @c -report-emission.
+struct EmissionReport {
+    size_t num_bodies = 0;         ///< All function bodies of the module.
+    size_t num_emitted = 0;        ///< The bodies reachable from a root - the others are skipped.
+    size_t num_instances = 0;      ///< Emitted instances of polymorphic functions.
+    size_t num_instantiations = 0; ///< Instantiations of polymorphic functions - several may share one instance.
+    double milliseconds = 0;       ///< Time spent emitting the module.
+};
+
+struct EmitOptions {
+    EmitOptions()
+        : pe_budget(65536)
+        , pe_site_budget(4096)
+        , pe_report(nullptr)
+        , auto_pe(false)
+        , auto_pe_size(64)
+        , closure_report(nullptr)
+        , target_clones(nullptr)
+        , fast_math(false)
+        , emission_report(nullptr)
+    {}
+
+    /// Limits the partial evaluation requested via @c @ - measured in Thorin defs.
+    size_t pe_budget;      ///< For all call sites and run blocks together.
+    size_t pe_site_budget; ///< For each call site and run block.
+    PEReport* pe_report;   ///< Receives a @p PEReport::Site for each @c @ if not @c nullptr.
+    bool auto_pe;          ///< Also specialize unannotated calls with static arguments to small callees.
+    size_t auto_pe_size;   ///< Maximal size of a callee chosen by @p auto_pe - measured in Thorin defs.
+    ClosureReport* closure_report; ///< Receives the location of each lambda if not @c nullptr.
+    std::vector<std::string> default_target_clones; ///< Features of functions marked with a bare @c #[target_clones].
+    TargetClones* target_clones;   ///< Receives the clone of each function marked with @c #[target_clones] if not @c nullptr.
+    bool fast_math;                ///< As if each function was marked with @c #[fast_math].
+    EmissionReport* emission_report; ///< Receives the counts of the lazy emission if not @c nullptr.
+};
+
+void emit(thorin::World&, const Module*, const EmitOptions& = EmitOptions());
 
 enum Prec {
     BOTTOM,
@@ -95,6 +138,11 @@ extern int global_num_errors;
 int num_warnings();
 int num_errors();
 
+/// Incremented by the global @c operator @c new of the driver if built with @c IMPALA_COUNT_ALLOCS.
+extern size_t global_num_allocs;
+/// Reports the allocations since the previous call as allocations of @p phase if built with @c IMPALA_COUNT_ALLOCS.
+void log_allocs(const char* phase);
+
 template<typename... Args>
 std::ostream& warning(const thorin::Location& loc, const char* fmt, Args... args) {
     ++global_num_warnings;
@@ -0,0 +1,35 @@
+#ifndef IMPALA_INTRINSIC
+#define IMPALA_INTRINSIC(name)
+#endif
+
+// functions of an extern "thorin" block which are handled by CodeGen
+IMPALA_INTRINSIC(bitcast)
+IMPALA_INTRINSIC(select)       // also lane-wise with a simd[bool * N] mask
+IMPALA_INTRINSIC(sizeof)
+// simd - shuffle masks are simd literals of lane indices; indices >= N select from the second vector
+IMPALA_INTRINSIC(shuffle)      // (simd[T * N], simd[T * N], mask) -> simd[T * N]
+IMPALA_INTRINSIC(broadcast)    // (T) -> simd[T * N]
+IMPALA_INTRINSIC(hadd)         // (simd[T * N]) -> T
+IMPALA_INTRINSIC(hmin)         // (simd[T * N]) -> T
+IMPALA_INTRINSIC(hmax)         // (simd[T * N]) -> T
+IMPALA_INTRINSIC(simd_lanes)   // [simd[T * N]]() -> i32 - N as a constant; useful for simd[T * native]
+// masked memory accesses - only lanes enabled in the simd[bool * N] mask touch memory; disabled lanes load from passthru
+IMPALA_INTRINSIC(masked_load)  // (&simd[T * N], mask, passthru: simd[T * N]) -> simd[T * N]
+IMPALA_INTRINSIC(masked_store) // (&simd[T * N], mask, simd[T * N]) -> ()
+IMPALA_INTRINSIC(gather)       // (&[T], indices: simd[int * N], mask, passthru: simd[T * N]) -> simd[T * N]
+IMPALA_INTRINSIC(scatter)      // (&[T], indices: simd[int * N], mask, simd[T * N]) -> ()
+IMPALA_INTRINSIC(assume_aligned) // (ptr: T, align: integer literal) -> T - ptr, which LLVM may take to be a multiple of align
+// math - T is a float or a simd vector of floats
+IMPALA_INTRINSIC(fma)          // (a: T, b: T, c: T) -> T - a * b + c with a single rounding
+IMPALA_INTRINSIC(rsqrt)        // (T) -> T - 1 / sqrt(x), may be approximated
+IMPALA_INTRINSIC(reserve_shared)
+// atomics - memory orderings use LLVM's encoding (monotonic = 2, acquire = 4, release = 5, acq_rel = 6, seq_cst = 7)
+// trailing orderings may be omitted; omitted, invalid and non-constant orderings are seq_cst
+IMPALA_INTRINSIC(atomic)       // rmw:  (binop: u32, ptr, val, order) -> T
+IMPALA_INTRINSIC(atomic_load)  //       (ptr, order) -> T
+IMPALA_INTRINSIC(atomic_store) //       (ptr, val, order) -> ()
+IMPALA_INTRINSIC(cmpxchg)      //       (ptr, cmp, val, success order, failure order) -> (T, bool)
+IMPALA_INTRINSIC(cmpxchg_weak) // may fail spuriously
+IMPALA_INTRINSIC(fence)        //       (order) -> ()
+
+#undef IMPALA_INTRINSIC
@@ -0,0 +1,332 @@
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
+#if LLVM_VERSION_MAJOR >= 14
+#include <llvm/MC/TargetRegistry.h>
+#else
+#include <llvm/Support/TargetRegistry.h>
+#endif
+
+#include "impala/llvm.h"
+
+namespace impala {
+
+/*
+ * builtins
+ */
+
+/**
+ * The memory ordering in LLVM's encoding which @p value holds if it is a constant accepted by @p is_valid.
+ * Otherwise, sequential consistency - it is valid for all atomic operations and stronger than any ordering.
+ */
+template<class Valid>
+static llvm::AtomicOrdering ordering(llvm::Value* value, Valid is_valid) {
+    if (auto constant = llvm::dyn_cast<llvm::ConstantInt>(value)) {
+        auto encoding = constant->getZExtValue();
+        if (llvm::isValidAtomicOrdering(encoding) && is_valid(llvm::AtomicOrdering(encoding)))
+            return llvm::AtomicOrdering(encoding);
+    }
+    return llvm::AtomicOrdering::SequentiallyConsistent;
+}
+
+static bool is_load_ordering(llvm::AtomicOrdering o) {
+    return o != llvm::AtomicOrdering::NotAtomic && o != llvm::AtomicOrdering::Release && o != llvm::AtomicOrdering::AcquireRelease;
+}
+static bool is_store_ordering(llvm::AtomicOrdering o) {
+    return o != llvm::AtomicOrdering::NotAtomic && o != llvm::AtomicOrdering::Acquire && o != llvm::AtomicOrdering::AcquireRelease;
+}
+static bool is_rmw_ordering(llvm::AtomicOrdering o) { return llvm::isStrongerThanUnordered(o); }
+static bool is_failure_ordering(llvm::AtomicOrdering o) { return is_rmw_ordering(o) && is_load_ordering(o); }
+static bool is_fence_ordering(llvm::AtomicOrdering o) { return llvm::isStrongerThanMonotonic(o); }
+
+/// Atomic accesses of @p type are aligned to its size as in C11.
+static llvm::Align atomic_align(const llvm::Module& module, llvm::Type* type) {
+    return llvm::Align(llvm::PowerOf2Ceil(module.getDataLayout().getTypeStoreSize(type)));
+}
+
+/// Returns the instructions replacing @p call of the builtin for @p intrinsic - @c nullptr if the builtin has no result.
+static llvm::Value* lower_builtin(llvm::IRBuilder<>& builder, llvm::StringRef intrinsic, llvm::CallInst* call) {
+    auto& module = *call->getModule();
+    auto arg = [&] (unsigned i) { return call->getArgOperand(i); };
+
+    if (intrinsic == "atomic_load") {
+        auto load = builder.CreateAlignedLoad(call->getType(), arg(0), atomic_align(module, call->getType()));
+        load->setAtomic(ordering(arg(1), is_load_ordering));
+        return load;
+    }
+    if (intrinsic == "atomic_store") {
+        auto store = builder.CreateAlignedStore(arg(1), arg(0), atomic_align(module, arg(1)->getType()));
+        store->setAtomic(ordering(arg(2), is_store_ordering));
+        return nullptr;
+    }
+    if (intrinsic == "atomic") {
+        auto op = llvm::dyn_cast<llvm::ConstantInt>(arg(0));
+        if (op == nullptr || op->getZExtValue() > llvm::AtomicRMWInst::LAST_BINOP)
+            throw std::runtime_error("the operation of 'atomic' must be a constant such as 1u for an addition");
+        auto binop = llvm::AtomicRMWInst::BinOp(op->getZExtValue());
+        auto o = ordering(arg(3), is_rmw_ordering);
+#if LLVM_VERSION_MAJOR >= 13
+        return builder.CreateAtomicRMW(binop, arg(1), arg(2), atomic_align(module, arg(2)->getType()), o);
+#else
+        return builder.CreateAtomicRMW(binop, arg(1), arg(2), o);
+#endif
+    }
+    if (intrinsic == "cmpxchg" || intrinsic == "cmpxchg_weak") {
+        auto success = ordering(arg(3), is_rmw_ordering);
+        auto failure = ordering(arg(4), is_failure_ordering);
+#if LLVM_VERSION_MAJOR >= 13
+        auto cmpxchg = builder.CreateAtomicCmpXchg(arg(0), arg(1), arg(2), atomic_align(module, arg(1)->getType()), success, failure);
+#else
+        if (llvm::isStrongerThan(failure, success)) // not allowed before LLVM 13
+            success = llvm::AtomicOrdering::SequentiallyConsistent;
+        auto cmpxchg = builder.CreateAtomicCmpXchg(arg(0), arg(1), arg(2), success, failure);
+#endif
+        cmpxchg->setWeak(intrinsic == "cmpxchg_weak");
+        return cmpxchg; // { T, i1 } like the result of the builtin
+    }
+    if (intrinsic == "fence") {
+        builder.CreateFence(ordering(arg(0), is_fence_ordering));
+        return nullptr;
+    }
+    if (intrinsic == "shuffle") {
+        auto mask = llvm::dyn_cast<llvm::Constant>(arg(2));
+        if (mask == nullptr)
+            throw std::runtime_error("the mask of 'shuffle' must be a constant");
+        return builder.CreateShuffleVector(arg(0), arg(1), mask);
+    }
+    if (intrinsic == "hadd" || intrinsic == "hmin" || intrinsic == "hmax") {
+        // the lanes may be combined in any order - as a tree of shuffles rather than one after another
+        auto vec = arg(0);
+        bool is_signed = llvm::cast<llvm::ConstantInt>(arg(1))->isOne();
+        bool is_fp = vec->getType()->isFPOrFPVectorTy();
+        llvm::Value* result;
+        if (intrinsic == "hadd")
+            result = is_fp ? builder.CreateFAddReduce(llvm::ConstantFP::getNegativeZero(call->getType()), vec) : builder.CreateAddReduce(vec);
+        else if (intrinsic == "hmin")
+            result = is_fp ? builder.CreateFPMinReduce(vec) : builder.CreateIntMinReduce(vec, is_signed);
+        else
+            result = is_fp ? builder.CreateFPMaxReduce(vec) : builder.CreateIntMaxReduce(vec, is_signed);
+        if (is_fp)
+            llvm::cast<llvm::Instruction>(result)->setHasAllowReassoc(true);
+        return result;
+    }
+    if (intrinsic == "masked_load" || intrinsic == "masked_store" || intrinsic == "gather" || intrinsic == "scatter") {
+        bool indexed = intrinsic == "gather" || intrinsic == "scatter";
+        auto ptr  = arg(0);
+        auto mask = arg(indexed ? 2 : 1);
+        auto vec  = arg(indexed ? 3 : 2);
+        auto elem_type = vec->getType()->getScalarType();
+        auto align = module.getDataLayout().getABITypeAlign(elem_type); // the vectors may start at any element
+        if (indexed) {
+            // a vector of the addresses of the elements of the array at the indices
+            auto elem_ptr_type = elem_type->getPointerTo(ptr->getType()->getPointerAddressSpace());
+            ptr = builder.CreateInBoundsGEP(elem_type, builder.CreatePointerCast(ptr, elem_ptr_type), arg(1));
+        }
+#if LLVM_VERSION_MAJOR >= 13
+        if (intrinsic == "masked_load")
+            return builder.CreateMaskedLoad(vec->getType(), ptr, align, mask, vec);
+        if (intrinsic == "gather")
+            return builder.CreateMaskedGather(vec->getType(), ptr, align, mask, vec);
+#else
+        if (intrinsic == "masked_load")
+            return builder.CreateMaskedLoad(ptr, align, mask, vec);
+        if (intrinsic == "gather")
+            return builder.CreateMaskedGather(ptr, align, mask, vec);
+#endif
+        if (intrinsic == "masked_store")
+            builder.CreateMaskedStore(vec, ptr, align, mask);
+        else
+            builder.CreateMaskedScatter(vec, ptr, align, mask);
+        return nullptr;
+    }
+    throw std::runtime_error("unknown builtin '" + call->getCalledFunction()->getName().str() + "'");
+}
+
+/// Replaces each call of a builtin - see @p builtin_prefix.
+static void lower_builtins(llvm::Module& module) {
+    std::vector<llvm::Function*> builtins;
+    for (auto& function : module) {
+        if (function.isDeclaration() && function.getName().startswith(builtin_prefix))
+            builtins.push_back(&function);
+    }
+
+    for (auto builtin : builtins) {
+        auto intrinsic = builtin->getName().drop_front(std::strlen(builtin_prefix)).split('.').first;
+        while (!builtin->use_empty()) {
+            auto call = llvm::cast<llvm::CallInst>(builtin->user_back());
+            llvm::IRBuilder<> builder(call);
+            if (auto result = lower_builtin(builder, intrinsic, call))
+                call->replaceAllUsesWith(result);
+            call->eraseFromParent();
+        }
+        builtin->eraseFromParent();
+    }
+}
+
+/*
+ * attributes
+ */
+
+/**
+ * Removes @p marker and the digits directly following it from the name of @p value.
+ * Returns @c false if the name does not contain @p marker; otherwise the digits are stored in @p number if given.
+ */
+static bool strip_marker(llvm::Value* value, const char* marker, unsigned* number = nullptr) {
+    auto name = value->getName().str();
+    auto pos = name.find(marker);
+    if (pos == std::string::npos)
+        return false;
+    auto end = pos + std::strlen(marker);
+    unsigned n = 0;
+    for (; end < name.size() && std::isdigit(name[end]); ++end)
+        n = n * 10 + (name[end] - '0');
+    if (number)
+        *number = n;
+    value->setName(name.erase(pos, end - pos));
+    return true;
+}
+
+static void add_attributes(llvm::Module& module) {
+    unsigned align;
+    for (auto& global : module.globals()) {
+        if (strip_marker(&global, align_marker, &align) && align > global.getAlignment())
+            global.setAlignment(llvm::MaybeAlign(align));
+    }
+
+    for (auto& function : module) {
+        for (auto& arg : function.args()) {
+            if (strip_marker(&arg, noalias_marker) && arg.getType()->isPointerTy())
+                arg.addAttr(llvm::Attribute::NoAlias);
+        }
+        // values derived from a parameter may have inherited its name
+        for (auto& block : function) {
+            for (auto& inst : block) {
+                strip_marker(&inst, noalias_marker);
+                if (strip_marker(&inst, align_marker, &align)) {
+                    if (auto alloca = llvm::dyn_cast<llvm::AllocaInst>(&inst)) {
+                        if (align > alloca->getAlign().value())
+                            alloca->setAlignment(llvm::Align(align));
+                    }
+                }
+            }
+        }
+    }
+}
+
+/// Each function is compiled for @p target; each of the @p clones additionally for its feature.
+static void add_target_attributes(llvm::Module& module, const Target& target, const TargetClones& clones) {
+    for (auto& function : module) {
+        if (function.isDeclaration())
+            continue;
+        if (!target.cpu.empty())
+            function.addFnAttr("target-cpu", target.cpu);
+        if (!target.features.empty())
+            function.addFnAttr("target-features", target.features);
+    }
+
+    for (const auto& clone : clones) {
+        if (auto function = module.getFunction(clone.name)) {
+            auto features = target.features + (target.features.empty() ? "" : ",") + "+" + target_feature_name(clone.feature);
+            function->addFnAttr("target-features", features);
+        }
+    }
+}
+
+/// The machine for @p target - @c nullptr if LLVM does not know the triple of @p module.
+static std::unique_ptr<llvm::TargetMachine> target_machine(const llvm::Module& module, const Target& target) {
+    llvm::InitializeNativeTarget();
+    auto triple = module.getTargetTriple().empty() ? llvm::sys::getDefaultTargetTriple() : module.getTargetTriple();
+    std::string error;
+    auto llvm_target = llvm::TargetRegistry::lookupTarget(triple, error);
+    if (llvm_target == nullptr)
+        return nullptr;
+    return std::unique_ptr<llvm::TargetMachine>(
+        llvm_target->createTargetMachine(triple, target.cpu, target.features, llvm::TargetOptions(), llvm::None));
+}
+
+#if LLVM_VERSION_MAJOR >= 14
+typedef llvm::OptimizationLevel OptimizationLevel;
+#else
+typedef llvm::PassBuilder::OptimizationLevel OptimizationLevel;
+#endif
+
+/**
+ * LLVM's default pipeline at level @p opt: 0 to 3 or -1 for @c -Os.
+ * With a @p machine the cost models of the vectorizers know the vector registers of the target.
+ */
+static void optimize(llvm::Module& module, int opt, llvm::TargetMachine* machine) {
+    if (opt == 0)
+        return;
+
+    llvm::LoopAnalysisManager loops;
+    llvm::FunctionAnalysisManager functions;
+    llvm::CGSCCAnalysisManager sccs;
+    llvm::ModuleAnalysisManager modules;
+    llvm::PassBuilder builder(machine);
+    builder.registerModuleAnalyses(modules);
+    builder.registerCGSCCAnalyses(sccs);
+    builder.registerFunctionAnalyses(functions);
+    builder.registerLoopAnalyses(loops);
+    builder.crossRegisterProxies(loops, functions, sccs, modules);
+
+    auto level = opt == -1 ? OptimizationLevel::Os
+               : opt ==  1 ? OptimizationLevel::O1
+               : opt ==  2 ? OptimizationLevel::O2
+               :             OptimizationLevel::O3;
+    builder.buildPerModuleDefaultPipeline(level).run(module, modules);
+}
+
+/// Only the CPU module gets the @p target and the @p clones if given.
+static void finish(const std::string& file, int opt, const Target* target, const TargetClones* clones) {
+    llvm::LLVMContext context;
+    llvm::SMDiagnostic diag;
+    auto module = llvm::parseIRFile(file, diag, context);
+    if (!module)
+        throw std::runtime_error("cannot read '" + file + "': " + diag.getMessage().str());
+
+    lower_builtins(*module);
+    add_attributes(*module);
+    std::unique_ptr<llvm::TargetMachine> machine;
+    if (target) {
+        add_target_attributes(*module, *target, *clones);
+        machine = target_machine(*module, *target);
+    }
+    std::string error;
+    llvm::raw_string_ostream errors(error);
+    if (llvm::verifyModule(*module, &errors))
+        throw std::runtime_error("invalid LLVM module '" + file + "': " + errors.str());
+    optimize(*module, opt, machine.get());
+
+    std::error_code ec;
+    llvm::raw_fd_ostream out(file, ec);
+    if (ec)
+        throw std::runtime_error("cannot write '" + file + "': " + ec.message());
+    module->print(out, nullptr);
+}
+
+void finish_llvm(const std::string& module_name, int opt, const Target& target, const TargetClones& clones) {
+    finish(module_name + ".ll", opt, &target, &clones);
+    for (auto ext : { ".nvvm", ".amdgpu" }) {
+        if (std::ifstream(module_name + ext))
+            finish(module_name + ext, opt, nullptr, nullptr);
+    }
+}
+
+}
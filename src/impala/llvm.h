@@ -0,0 +1,42 @@
+#ifndef IMPALA_LLVM_H
+#define IMPALA_LLVM_H
+
+#include <string>
+
+#include "impala/target.h"
+
+namespace impala {
+
+/**
+ * Thorin's LLVM backend knows no parameter attributes or alignment - they are encoded in the names of the LLVM values.
+ * Impala identifiers cannot contain a @c . - so these markers cannot clash with names chosen by the programmer.
+ */
+static const char noalias_marker[] = ".noalias"; ///< Appended to each parameter marked by @p borrow_check.
+static const char align_marker[]   = ".align";   ///< Appended - followed by the alignment in bytes - to aligned variables.
+
+/**
+ * Prefix of Impala's builtins: external functions which CodeGen calls for operations that Thorin cannot express, such
+ * as atomics with memory orderings or vector shuffles, reductions and masked memory accesses.
+ * The name of a builtin is the prefix, the name of its intrinsic in intrinsiclist.h and the mangled types of its
+ * parameters - e.g. <tt>impala.atomic_load.p0i32.i32</tt>.
+ * @p finish_llvm replaces each call of a builtin by LLVM instructions.
+ */
+static const char builtin_prefix[] = "impala.";
+
+/**
+ * Completes the LLVM module @p module_name.ll written by @c thorin::emit_llvm without optimization:
+ * the builtins are lowered, the attributes and alignments encoded in names are added and the markers are removed from the names again - the
+ * names of the symbols stay as Thorin would have chosen them.
+ * Each function is compiled for @p target - with @c native already resolved - and each of the @p clones additionally for
+ * its feature.
+ * Then the module is optimized with LLVM's default pipeline at level @p opt - such that LLVM's optimizations see the
+ * attributes and the target.
+ * The same happens to the modules of the GPU backends in @p module_name.nvvm and @p module_name.amdgpu if they exist -
+ * without a target.
+ * Throws @c std::runtime_error if a module cannot be read or written.
+ */
+void finish_llvm(const std::string& module_name, int opt, const Target& target, const TargetClones& clones);
+
+}
+
+#endif
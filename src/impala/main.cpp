@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <fstream>
 #include <vector>
 #include <cctype>
+#include <cstdlib>
+#include <new>
 #include <stdexcept>
 
 #include "thorin/be/llvm/llvm.h"
@@ -12,7 +15,11 @@
 
 #include "impala/ast.h"
 #include "impala/cgen.h"
+#include "impala/closurereport.h"
 #include "impala/impala.h"
+#include "impala/llvm.h"
+#include "impala/pereport.h"
+#include "impala/target.h"
 
 //------------------------------------------------------------------------------
 
@@ -23,6 +30,58 @@ typedef vector<string> Names;
 
 //------------------------------------------------------------------------------
 
+#ifdef IMPALA_COUNT_ALLOCS
+// counts all allocations of the compiler - see impala::log_allocs
+static void* count_alloc(size_t size) noexcept {
+    ++impala::global_num_allocs;
+    return std::malloc(size != 0 ? size : 1);
+}
+
+static void* count_alloc_or_throw(size_t size) {
+    if (auto p = count_alloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new  (size_t size) { return count_alloc_or_throw(size); }
+void* operator new[](size_t size) { return count_alloc_or_throw(size); }
+void* operator new  (size_t size, const std::nothrow_t&) noexcept { return count_alloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return count_alloc(size); }
+void operator delete  (void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete  (void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete  (void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+#ifdef __cpp_aligned_new
+static void* count_aligned_alloc(size_t size, std::align_val_t align) noexcept {
+    ++impala::global_num_allocs;
+    void* p = nullptr;
+    return posix_memalign(&p, std::max(size_t(align), sizeof(void*)), size != 0 ? size : 1) == 0 ? p : nullptr;
+}
+
+static void* count_aligned_alloc_or_throw(size_t size, std::align_val_t align) {
+    if (auto p = count_aligned_alloc(size, align))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new  (size_t size, std::align_val_t align) { return count_aligned_alloc_or_throw(size, align); }
+void* operator new[](size_t size, std::align_val_t align) { return count_aligned_alloc_or_throw(size, align); }
+void* operator new  (size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return count_aligned_alloc(size, align); }
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return count_aligned_alloc(size, align); }
+void operator delete  (void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete  (void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete  (void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+#endif
+#endif
+
+//------------------------------------------------------------------------------
+
 ostream* open(ofstream& stream, const string& name) {
     if (name == "-")
         return &cout;
@@ -41,11 +100,11 @@ int main(int argc, char** argv) {
 #ifndef NDEBUG
         Names breakpoints;
 #endif
-        string out_name, log_name, log_level;
+        string out_name, log_name, log_level, pe_budget, pe_site_budget, report_pe, auto_pe_size, target_clones, target_cpu, target_features;
         bool help,
              emit_cint, emit_thorin, emit_ast, emit_annotated, emit_llvm, emit_ycomp, emit_ycomp_cfg,
              opt_thorin, opt_s, opt_0, opt_1, opt_2, opt_3, debug,
-             nocleanup, nossa, fancy;
+             nocleanup, nossa, fancy, auto_pe, warn_closures, report_closures, fast_math, report_emission;
         YCompCommandLine yComp;
 
         auto cmd_parser = ArgParser()
@@ -63,6 +122,8 @@ int main(int argc, char** argv) {
             .add_option<bool>            ("O3",                 "",                               "optimize yet more", opt_3, false)
             .add_option<bool>            ("Os",                 "",                               "optimize for size", opt_s, false)
             .add_option<bool>            ("Othorin",            "",                               "optimize at Thorin level", opt_thorin, false)
+            .add_option<bool>            ("auto-pe",            "",                               "specialize calls passing functions or literals to small callees as if they were annotated with '@'; see -report-pe for the chosen calls", auto_pe, false)
+            .add_option<string>          ("auto-pe-size",       "<arg>",                          "maximal number of Thorin defs of a callee chosen by -auto-pe; default is 64", auto_pe_size, "64")
             .add_option<bool>            ("emit-annotated",     "",                               "emit AST of Impala program after semantic analysis", emit_annotated, false)
             .add_option<bool>            ("emit-ast",           "",                               "emit AST of Impala program", emit_ast, false)
             .add_option<bool>            ("emit-c-interface",   "",                               "emit C interface from Impala code (experimental)", emit_cint, false)
@@ -71,19 +132,42 @@ int main(int argc, char** argv) {
             .add_option<bool>            ("emit-ycomp",         "",                               "emit ycomp-compatible graph representation of Impala program", emit_ycomp, false)
             .add_option<bool>            ("emit-ycomp-cfg",     "",                               "emit ycomp-compatible control-flow graph representation of Impala program", emit_ycomp_cfg, false)
             .add_option<bool>            ("f",                  "",                               "use fancy output: Impala's AST dump uses only parentheses where necessary", fancy, false)
+            .add_option<bool>            ("ffast-math",         "",                               "allow reassociation, contraction and approximation of all floating-point arithmetic as if each function was marked with '#[fast_math]'", fast_math, false)
             .add_option<bool>            ("g",                  "",                               "emit debug information", debug, false)
             .add_option<bool>            ("nocleanup",          "",                               "no clean-up phase", nocleanup, false)
             .add_option<bool>            ("nossa",              "",                               "use slots + load/store instead of SSA construction", nossa, false)
+            .add_option<string>          ("pe-budget",          "<arg>",                          "maximal number of Thorin defs specialized via '@' in total", pe_budget, "65536")
+            .add_option<string>          ("pe-site-budget",     "<arg>",                          "maximal number of Thorin defs specialized via '@' per call site or run block; also bounds how often a recursive callee is unfolded", pe_site_budget, "4096")
+            .add_option<bool>            ("report-closures",    "",                               "report for each lambda whether optimization eliminates it, leaves only direct calls or turns it into a closure on stdout (implies -Othorin)", report_closures, false)
+            .add_option<bool>            ("report-emission",    "",                               "report the function bodies skipped because they are unreachable and the emission time on stdout", report_emission, false)
+            .add_option<string>          ("report-pe",          "{text|json}",                    "report the specializations created for each '@' call site and run block on stdout (implies -Othorin)", report_pe, "")
+            .add_option<string>          ("target-cpu",         "<arg>",                          "LLVM name of the CPU to emit code for or 'native' for the host; also determines the lanes of 'simd[T * native]'", target_cpu, "")
+            .add_option<string>          ("target-features",    "<arg>",                          "comma-separated LLVM target features such as '+avx2,-avx512f'; override those of -target-cpu", target_features, "")
+            .add_option<string>          ("target-clones",      "<arg>",                          "comma-separated target features of functions marked with a bare '#[target_clones]'; default is sse4.2,avx2,avx512f", target_clones, "sse4.2,avx2,avx512f")
+            .add_option<bool>            ("warn-closures",      "",                               "warn about lambdas which survive optimization as closures (implies -Othorin)", warn_closures, false)
             .add_option<YCompCommandLine>("ycomp",              "{cfg|domtree|domfrontiers|looptree} {true|false} <arg>    ",
                 "print ycomp graph to <arg>; the flag indicates whether the graph is based upon a forward (true) or backwards (false) CFG; the option can be specified multiple times",
                 yComp, YCompCommandLine());
 
         // do cmdline parsing
         cmd_parser.parse(argc, argv);
-        opt_thorin |= emit_llvm;
+        opt_thorin |= emit_llvm || !report_pe.empty() || warn_closures || report_closures;
+        if (!report_pe.empty() && report_pe != "text" && report_pe != "json")
+            throw invalid_argument("partial evaluation report format must be one of {text|json}");
 
         impala::fancy() = fancy;
 
+        vector<string> default_target_clones;
+        for (size_t b = 0, e; b < target_clones.size(); b = e + 1) {
+            e = std::min(target_clones.find(',', b), target_clones.size());
+            default_target_clones.push_back(target_clones.substr(b, e - b));
+            if (impala::target_feature(default_target_clones.back()) == impala::Num_TargetFeatures)
+                throw invalid_argument("unknown target feature '" + default_target_clones.back() + "'");
+        }
+
+        auto target = impala::resolve_native({target_cpu, target_features});
+        impala::native_simd_width() = impala::simd_width(target);
+
 #ifndef NDEBUG
         ofstream log_stream;
         if (log_level == "none") {
@@ -161,12 +245,14 @@ int main(int argc, char** argv) {
         }
 #endif
 
+        impala::log_allocs("initialization");
         impala::Items items;
         for (const auto& infile : infiles) {
             auto filename = infile.c_str();
             ifstream file(filename);
             impala::parse(items, file, filename);
         }
+        impala::log_allocs("parsing");
 
         auto module = std::make_unique<const impala::Module>(infiles.front().c_str(), std::move(items));
 
@@ -203,16 +289,61 @@ int main(int argc, char** argv) {
             impala::generate_c_interface(module.get(), opts, out_file);
         }
 
-        if (result && (emit_llvm || emit_thorin || emit_ycomp || emit_ycomp_cfg))
-            emit(init.world, module.get());
+        impala::PEReport pe_report;
+        impala::ClosureReport closure_report;
+        impala::TargetClones clones;
+        impala::EmissionReport emission_report;
+        if (result && (emit_llvm || emit_thorin || emit_ycomp || emit_ycomp_cfg || !report_pe.empty() || warn_closures || report_closures || report_emission)) {
+            impala::EmitOptions opts;
+            opts.pe_budget = std::stoul(pe_budget);
+            opts.pe_site_budget = std::stoul(pe_site_budget);
+            opts.auto_pe = auto_pe;
+            opts.auto_pe_size = std::stoul(auto_pe_size);
+            if (!report_pe.empty())
+                opts.pe_report = &pe_report;
+            if (warn_closures || report_closures)
+                opts.closure_report = &closure_report;
+            opts.default_target_clones = default_target_clones;
+            opts.target_clones = &clones;
+            opts.fast_math = fast_math;
+            if (report_emission)
+                opts.emission_report = &emission_report;
+            emit(init.world, module.get(), opts);
+            impala::log_allocs("emission");
+            if (report_emission) {
+                const auto& r = emission_report;
+                std::cout << "emitted " << r.num_emitted << " of " << r.num_bodies << " function bodies and "
+                          << r.num_instances << " instances for " << r.num_instantiations << " instantiations in "
+                          << r.milliseconds << " ms" << std::endl;
+                std::cout << "skipped " << r.num_bodies - r.num_emitted << " unreachable function bodies" << std::endl;
+            }
+        }
 
         if (result) {
             if (!nocleanup)
                 init.world.cleanup();
             if (opt_thorin)
                 init.world.opt();
+            impala::log_allocs("optimization");
+            if (!report_pe.empty()) {
+                pe_report.collect(init.world);
+                if (report_pe == "json")
+                    pe_report.stream_json(std::cout);
+                else
+                    pe_report.stream_text(std::cout);
+            }
+            if (warn_closures || report_closures) {
+                closure_report.collect(init.world);
+                if (warn_closures)
+                    closure_report.warn();
+                if (report_closures)
+                    closure_report.stream_text(std::cout);
+            }
             if (emit_thorin)      init.world.dump();
-            if (emit_llvm)        thorin::emit_llvm(init.world, opt, debug);
+            if (emit_llvm) {
+                thorin::emit_llvm(init.world, 0, debug); // impala::finish_llvm optimizes
+                impala::finish_llvm(module_name, opt, target, clones);
+            }
             if (emit_ycomp)       thorin::emit_ycomp(init.world, true);
             if (emit_ycomp_cfg)   thorin::emit_ycomp_cfg(init.world);
             yComp.print(init.world);
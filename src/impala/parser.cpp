@@ -187,6 +187,7 @@ public:
     Visibility parse_visibility();
     uint64_t parse_integer(const char* what);
     int parse_addr_space();
+    unsigned parse_ptr_align();
     char char_value(const char*& p);
 
     // paths
@@ -222,14 +223,18 @@ public:
     // items + helpers
     const Item*        parse_item();
     void               parse_items(Items&);
-    const StaticItem*  parse_static_item(Tracker, Visibility);
+    const StaticItem*  parse_static_item(Tracker, Visibility, unsigned align = 0);
     const EnumDecl*    parse_enum_decl(Tracker, Visibility);
-    const FnDecl*      parse_fn_decl(BodyMode, Tracker, Visibility, bool is_extern, Symbol abi);
+    const FnDecl*      parse_fn_decl(BodyMode, Tracker, Visibility, bool is_extern, Symbol abi,
+                                     Attributes&& attributes = Attributes());
+    Attributes         parse_attributes();
+    unsigned           parse_align(const char* context);
+    const Item*        parse_attributed_item(Tracker, Attributes&&);
     const ImplItem*    parse_impl(Tracker, Visibility);
     const Item*        parse_module_or_module_decl(Tracker, Visibility);
     const Module*      parse_module();
     const Item*        parse_extern_block_or_fn_decl(Tracker, Visibility);
-    const StructDecl*  parse_struct_decl(Tracker, Visibility);
+    const StructDecl*  parse_struct_decl(Tracker, Visibility, unsigned align = 0);
     const FieldDecl*   parse_field_decl(const size_t i);
     const TraitDecl*   parse_trait_decl(Tracker, Visibility);
     const Typedef*     parse_typedef(Tracker, Visibility);
@@ -253,7 +258,8 @@ public:
     const ForExpr*          parse_for_expr();
     const ForExpr*          parse_with_expr();
     const WhileExpr*        parse_while_expr();
-    const BlockExprBase*    parse_block_expr();
+    const BlockExprBase*    parse_block_expr(bool fast_math = false);
+    const BlockExprBase*    parse_attributed_block_expr(Attributes&&);
     const BlockExprBase*    try_block_expr(const std::string& context);
 
     // patterns
@@ -381,6 +387,15 @@ int Parser::parse_addr_space() {
     return 0;
 }
 
+/// <tt>align(N)</tt> after the address space of a pointer type - @c align is no keyword as no type is followed by @c (.
+unsigned Parser::parse_ptr_align() {
+    if (lookahead(0) == Token::ID && lookahead(0).symbol() == "align" && lookahead(1) == Token::L_PAREN) {
+        lex();
+        return parse_align("alignment annotation");
+    }
+    return 0;
+}
+
 /*
  * paths
  */
@@ -493,6 +508,8 @@ const Param* Parser::parse_return_param() {
 
 const Item* Parser::parse_item() {
     auto tracker = track();
+    if (lookahead() == Token::HASH)
+        return parse_attributed_item(tracker, parse_attributes());
     auto vis = parse_visibility();
 
     switch (lookahead()) {
@@ -532,10 +549,78 @@ const Item* Parser::parse_extern_block_or_fn_decl(Tracker tracker, Visibility vi
     return new ExternBlock(tracker, vis, abi, std::move(fn_decls));
 }
 
-const FnDecl* Parser::parse_fn_decl(BodyMode mode, Tracker tracker, Visibility vis, bool is_extern, Symbol abi) {
+/// One or more <tt>#[attribute, ...]</tt> groups with the attributes @c fast_math,
+/// @c target_clones or <tt>target_clones("feature", ...)</tt> and <tt>align(N)</tt>.
+Attributes Parser::parse_attributes() {
+    Attributes attributes;
+    while (accept(Token::HASH)) {
+        expect(Token::L_BRACKET, "attribute");
+        parse_comma_list("attribute", Token::R_BRACKET, [&] {
+            if (lookahead() != Token::ID) {
+                error("attribute", "attribute list");
+                return;
+            }
+
+            auto name = lex();
+            if (name.symbol() == "fast_math") {
+                attributes.fast_math = true;
+            } else if (name.symbol() == "target_clones") {
+                attributes.has_target_clones = true;
+                if (accept(Token::L_PAREN)) {
+                    parse_comma_list("target_clones attribute", Token::R_PAREN, [&] {
+                        if (lookahead() == Token::LIT_str)
+                            attributes.target_clones.emplace_back(parse_str());
+                        else
+                            error("target feature", "target_clones attribute");
+                    });
+                }
+            } else if (name.symbol() == "align") {
+                attributes.align = parse_align("align attribute");
+            } else
+                impala::error(name.location(), "unknown attribute '%'", name.symbol());
+        });
+    }
+    return attributes;
+}
+
+/// <tt>(N)</tt> where @c N is a power of two.
+unsigned Parser::parse_align(const char* context) {
+    expect(Token::L_PAREN, context);
+    auto location = lookahead().location();
+    auto align = parse_integer("alignment");
+    expect(Token::R_PAREN, context);
+    if (align == 0 || (align & (align - 1)) != 0 || align > (1u << 29)) {
+        impala::error(location, "alignment must be a power of two but found %", align);
+        return 0;
+    }
+    return align;
+}
+
+/// <tt>#[...] fn ...</tt>, also with @c extern, <tt>#[...] struct ...</tt> or <tt>#[...] static ...</tt>.
+const Item* Parser::parse_attributed_item(Tracker tracker, Attributes&& attributes) {
+    auto vis = parse_visibility();
+    switch (lookahead()) {
+        case Token::STATIC:
+        case Token::STRUCT:
+            if (attributes.fast_math || attributes.has_target_clones)
+                impala::error(lookahead().location(), "fast_math and target_clones attributes are only allowed on functions and blocks");
+            if (lookahead() == Token::STATIC)
+                return parse_static_item(tracker, vis, attributes.align);
+            return parse_struct_decl(tracker, vis, attributes.align);
+        default: {
+            if (attributes.align != 0)
+                impala::error(lookahead().location(), "align attribute is only allowed on structs and statics");
+            bool is_extern = accept(Token::EXTERN);
+            return parse_fn_decl(BodyMode::Mandatory, tracker, vis, is_extern, /*abi*/ "", std::move(attributes));
+        }
+    }
+}
+
+const FnDecl* Parser::parse_fn_decl(BodyMode mode, Tracker tracker, Visibility vis, bool is_extern, Symbol abi,
+                                    Attributes&& attributes) {
     //THORIN_PUSH(cur_var_handle, cur_var_handle);
 
-    eat(Token::FN);
+    expect(Token::FN, "function declaration"); // may follow an attribute
     auto export_name = lookahead() == Token::LIT_str ? lex().symbol() : Symbol();
     auto identifier = try_identifier("function name");
     auto ast_type_params = parse_ast_type_params();
@@ -555,7 +640,7 @@ const FnDecl* Parser::parse_fn_decl(BodyMode mode, Tracker tracker, Visibility v
     }
 
     return new FnDecl(tracker, vis, is_extern, abi, export_name, identifier, std::move(ast_type_params),
-                      std::move(params), body);
+                      std::move(params), body, std::move(attributes));
 }
 
 const ImplItem* Parser::parse_impl(Tracker tracker, Visibility vis) {
@@ -599,6 +684,7 @@ void Parser::parse_items(Items& items) {
         switch (lookahead()) {
             case VISIBILITY:
             case ITEM:
+            case Token::HASH:
                 items.emplace_back(parse_item());
                 continue;
             case Token::SEMICOLON:
@@ -610,17 +696,17 @@ void Parser::parse_items(Items& items) {
     }
 }
 
-const StaticItem* Parser::parse_static_item(Tracker tracker, Visibility vis) {
+const StaticItem* Parser::parse_static_item(Tracker tracker, Visibility vis, unsigned align) {
     eat(Token::STATIC);
     bool mut = accept(Token::MUT);
     auto identifier = try_identifier("static item");
     auto ast_type = accept(Token::COLON) ? parse_type() : nullptr;
     auto init = accept(Token::ASGN) ? parse_expr() : nullptr;
     expect(Token::SEMICOLON, "static item");
-    return new StaticItem(tracker, vis, mut, identifier, ast_type, init);
+    return new StaticItem(tracker, vis, mut, identifier, ast_type, init, align);
 }
 
-const StructDecl* Parser::parse_struct_decl(Tracker tracker, Visibility vis) {
+const StructDecl* Parser::parse_struct_decl(Tracker tracker, Visibility vis, unsigned align) {
     eat(Token::STRUCT);
     auto identifier = try_identifier("struct declaration");
     auto ast_type_params = parse_ast_type_params();
@@ -630,7 +716,7 @@ const StructDecl* Parser::parse_struct_decl(Tracker tracker, Visibility vis) {
     parse_comma_list("closing brace of struct declaration", Token::R_BRACE, [&] {
         field_decls.emplace_back(parse_field_decl(i++));
     });
-    return new StructDecl(tracker, vis, identifier, std::move(ast_type_params), std::move(field_decls));
+    return new StructDecl(tracker, vis, identifier, std::move(ast_type_params), std::move(field_decls), align);
 }
 
 const FieldDecl* Parser::parse_field_decl(const size_t i) {
@@ -773,8 +859,9 @@ const PtrASTType* Parser::parse_ptr_type() {
     if (accept(Token::ANDAND)) {
         auto kind = accept(Token::MUT) ? PtrASTType::Mut : PtrASTType::Borrowed;
         auto addr_space = parse_addr_space();
+        auto align = parse_ptr_align();
         auto referenced_ast_type = parse_type();
-        return new PtrASTType(tracker, PtrASTType::Borrowed, 0, new PtrASTType(tracker, kind, addr_space, referenced_ast_type));
+        return new PtrASTType(tracker, PtrASTType::Borrowed, 0, 0, new PtrASTType(tracker, kind, addr_space, align, referenced_ast_type));
     }
 
     PtrASTType::Kind kind;
@@ -789,8 +876,9 @@ const PtrASTType* Parser::parse_ptr_type() {
     }
 
     auto addr_space = parse_addr_space();
+    auto align = parse_ptr_align();
     auto referenced_ast_type = parse_type();
-    return new PtrASTType(tracker, kind, addr_space, referenced_ast_type);
+    return new PtrASTType(tracker, kind, addr_space, align, referenced_ast_type);
 }
 
 const TupleASTType* Parser::parse_tuple_type() {
@@ -832,6 +920,11 @@ const SimdASTType* Parser::parse_simd_type() {
     expect(Token::L_BRACKET, "simd type");
     auto elem_ast_type = parse_type();
     expect(Token::MUL, "simd type");
+    if (lookahead() == Token::ID && lookahead().symbol() == "native") {
+        lex();
+        expect(Token::R_BRACKET, "simd type");
+        return new SimdASTType(tracker, elem_ast_type, 0, true);
+    }
     auto size = parse_integer("simd vector size");
     expect(Token::R_BRACKET, "simd type");
     return new SimdASTType(tracker, elem_ast_type, size);
@@ -884,9 +977,10 @@ const Expr* Parser::parse_prefix_expr() {
 
     auto tracker = track();
     auto kind = lex().kind();
+    bool mut = kind == Token::AND && accept(Token::MUT);
     auto rhs = parse_expr(PrecTable::prefix_r[kind]);
 
-    return new PrefixExpr(tracker, (PrefixExpr::Kind) kind, rhs);
+    return new PrefixExpr(tracker, (PrefixExpr::Kind) kind, rhs, mut);
 }
 
 const Expr* Parser::parse_infix_expr(Tracker tracker, const Expr* lhs) {
@@ -1030,6 +1124,7 @@ const Expr* Parser::parse_primary_expr() {
         case Token::WHILE:      return parse_while_expr();
         case Token::L_BRACE:
         case Token::RUN_BLOCK:  return parse_block_expr();
+        case Token::HASH:       return parse_attributed_block_expr(parse_attributes());
         default:                error("expression", ""); return new EmptyExpr(lex().location());
     }
 }
@@ -1187,7 +1282,7 @@ const WhileExpr* Parser::parse_while_expr() {
     return new WhileExpr(tracker, continue_decl, cond, body, break_decl);
 }
 
-const BlockExprBase* Parser::parse_block_expr() {
+const BlockExprBase* Parser::parse_block_expr(bool fast_math) {
     auto tracker = track();
     bool run = accept(Token::RUN_BLOCK) ? true : (eat(Token::L_BRACE), false);
     Stmts stmts;
@@ -1196,10 +1291,21 @@ const BlockExprBase* Parser::parse_block_expr() {
         switch (lookahead()) {
             case Token::SEMICOLON:  lex(); continue; // ignore semicolon
             case STMT_NOT_EXPR:     stmts.emplace_back(parse_stmt_not_expr()); continue;
+            case Token::HASH: // either an attributed item or an attributed block
             case EXPR: {
                 auto tracker = track();
                 bool stmt_like = lookahead().is_stmt_like();
-                auto expr = parse_expr();
+                const Expr* expr;
+                if (lookahead() == Token::HASH) {
+                    auto attributes = parse_attributes();
+                    if (lookahead() != Token::L_BRACE && lookahead() != Token::RUN_BLOCK) {
+                        stmts.emplace_back(new ItemStmt(tracker, parse_attributed_item(tracker, std::move(attributes))));
+                        continue;
+                    }
+                    stmt_like = true;
+                    expr = parse_attributed_block_expr(std::move(attributes));
+                } else
+                    expr = parse_expr();
                 if (accept(Token::SEMICOLON) || (stmt_like && lookahead() != Token::R_BRACE)) {
                     stmts.emplace_back(new ExprStmt(tracker, expr));
                     continue;
@@ -1212,13 +1318,29 @@ const BlockExprBase* Parser::parse_block_expr() {
                 if (block_expr == nullptr)
                     block_expr = create<EmptyExpr>();
                 if (run)
-                    return new RunBlockExpr(tracker, std::move(stmts), block_expr);
+                    return new RunBlockExpr(tracker, std::move(stmts), block_expr, fast_math);
                 else
-                    return new BlockExpr(tracker, std::move(stmts), block_expr);
+                    return new BlockExpr(tracker, std::move(stmts), block_expr, fast_math);
         }
     }
 }
 
+/// <tt>#[fast_math] { ... }</tt> or <tt>#[fast_math] @{ ... }</tt>.
+const BlockExprBase* Parser::parse_attributed_block_expr(Attributes&& attributes) {
+    if (attributes.has_target_clones)
+        impala::error(lookahead().location(), "target_clones attribute is only allowed on functions");
+    if (attributes.align != 0)
+        impala::error(lookahead().location(), "align attribute is only allowed on structs and statics");
+    switch (lookahead()) {
+        case Token::L_BRACE:
+        case Token::RUN_BLOCK:
+            return parse_block_expr(attributes.fast_math);
+        default:
+            error("block expression", "attributed block");
+            return create<BlockExpr>();
+    }
+}
+
 const BlockExprBase* Parser::try_block_expr(const std::string& context) {
     switch (lookahead()) {
         case Token::L_BRACE:
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <sstream>
+
+#include "thorin/continuation.h"
+#include "thorin/world.h"
+#include "thorin/analyses/scope.h"
+
+#include "impala/pereport.h"
+
+namespace impala {
+
+/*
+ * The partial evaluator copies a callee for each specialization, and each copy keeps the debug information of the
+ * original.
+ * Hence, a continuation at the location of a callee whose name starts with the callee's name is either the original
+ * callee or a copy made by @p emit - identified by their gids - or one of its specializations.
+ */
+void PEReport::collect(thorin::World& world) {
+    for (auto& site : sites_) {
+        site.num_specializations = 0;
+        site.size_after = 0;
+    }
+
+    for (auto continuation : world.continuations()) {
+        if (continuation->empty())
+            continue;
+
+        std::ostringstream location;
+        location << continuation->location();
+        size_t size = 0;
+        for (auto& site : sites_) {
+            if (site.callee_location != location.str() || continuation->name().compare(0, site.callee.size(), site.callee) != 0)
+                continue;
+            if (size == 0)
+                size = thorin::Scope(continuation).defs().size();
+            site.size_after += size;
+            auto gid = continuation->gid();
+            if (gid != site.callee_gid && std::find(site.copy_gids.begin(), site.copy_gids.end(), gid) == site.copy_gids.end())
+                ++site.num_specializations;
+        }
+    }
+}
+
+static std::string residual(const PEReport::Site& site) {
+    if (!site.residual.empty())
+        return site.residual;
+    if (site.num_specializations == 0)
+        return "not specialized by the partial evaluator";
+    return std::string();
+}
+
+std::ostream& PEReport::stream_text(std::ostream& os) const {
+    for (const auto& site : sites_) {
+        os << site.location << ": " << (site.is_block ? "run block" : "call of '" + site.callee + "'")
+           << (site.is_auto ? " (automatic)" : "") << std::endl;
+        if (!site.is_block) {
+            os << "    static arguments:";
+            bool any = false;
+            for (size_t i = 0, e = site.static_args.size(); i != e; ++i) {
+                if (site.static_args[i]) {
+                    os << ' ' << i;
+                    any = true;
+                }
+            }
+            os << (any ? "" : " none") << std::endl;
+        }
+        os << "    specializations: " << site.num_specializations << std::endl;
+        os << "    size: " << site.size_before << " -> " << site.size_after << std::endl;
+        auto reason = residual(site);
+        if (!reason.empty())
+            os << "    residual: " << reason << std::endl;
+    }
+    return os;
+}
+
+static std::ostream& stream_json_string(std::ostream& os, const std::string& str) {
+    os << '"';
+    for (auto c : str) {
+        switch (c) {
+            case '"':  os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            case '\n': os << "\\n";  break;
+            case '\t': os << "\\t";  break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    static const char hex[] = "0123456789abcdef";
+                    os << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+                } else {
+                    os << c;
+                }
+                break;
+        }
+    }
+    return os << '"';
+}
+
+std::ostream& PEReport::stream_json(std::ostream& os) const {
+    os << '[';
+    for (size_t i = 0, e = sites_.size(); i != e; ++i) {
+        const auto& site = sites_[i];
+        os << (i == 0 ? "" : ",") << std::endl << "  {\"location\": ";
+        stream_json_string(os, site.location);
+        os << ", \"kind\": " << (site.is_block ? "\"block\"" : "\"call\"")
+           << ", \"auto\": " << (site.is_auto ? "true" : "false") << ", \"callee\": ";
+        stream_json_string(os, site.callee);
+        os << ", \"static_args\": [";
+        for (size_t j = 0, f = site.static_args.size(); j != f; ++j)
+            os << (j == 0 ? "" : ", ") << (site.static_args[j] ? "true" : "false");
+        os << "], \"specializations\": " << site.num_specializations
+           << ", \"size_before\": " << site.size_before
+           << ", \"size_after\": " << site.size_after
+           << ", \"residual\": ";
+        auto reason = residual(site);
+        if (reason.empty())
+            os << "null";
+        else
+            stream_json_string(os, reason);
+        os << '}';
+    }
+    return os << std::endl << ']' << std::endl;
+}
+
+}
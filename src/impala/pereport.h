@@ -0,0 +1,47 @@
+#ifndef IMPALA_PEREPORT_H
+#define IMPALA_PEREPORT_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace thorin { class World; }
+
+namespace impala {
+
+/**
+ * Summarizes what the partial evaluator did with the call sites and run blocks marked with @c @.
+ * @p emit records one @p Site per @c @ before any optimization took place;
+ * @p collect has to be invoked once partial evaluation has run.
+ */
+class PEReport {
+public:
+    struct Site {
+        std::string location;
+        bool is_block;
+        bool is_auto;                   ///< Chosen by @c -auto-pe instead of being annotated with @c @.
+        std::string callee;
+        std::string callee_location;
+        size_t callee_gid;
+        std::vector<bool> static_args;  ///< Excludes the memory and the return continuation.
+        size_t size_before;
+        std::vector<size_t> copy_gids;  ///< Copies of a recursive callee made to bound its unfolding - no specializations.
+        std::string residual;           ///< Why @p emit left a residual call; empty if the call was handed to the partial evaluator.
+        size_t num_specializations = 0; ///< Counted per callee - sites sharing a callee also share these numbers.
+        size_t size_after = 0;
+    };
+
+    const std::vector<Site>& sites() const { return sites_; }
+    void add(Site&& site) { sites_.emplace_back(std::move(site)); }
+    /// Finds the specializations of each callee in @p world.
+    void collect(thorin::World& world);
+    std::ostream& stream_text(std::ostream&) const;
+    std::ostream& stream_json(std::ostream&) const;
+
+private:
+    std::vector<Site> sites_;
+};
+
+}
+
+#endif
@@ -0,0 +1,635 @@
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "impala/ast.h"
+#include "impala/impala.h"
+#include "impala/sema/type.h"
+
+using namespace thorin;
+
+namespace impala {
+
+//------------------------------------------------------------------------------
+
+/*
+ * helpers
+ */
+
+/// Whether a value of @p type may hold an address - pointers, functions which may capture pointers, and generics.
+static bool may_alias(const Type* type) {
+    if (type->isa<TypeError>())
+        return false;
+    if (!type->is_known() || type->isa<PtrType>() || type->isa<FnType>() || type->isa<Var>())
+        return true;
+    for (size_t i = 0, e = type->num_ops(); i != e; ++i) {
+        if (may_alias(type->op(i)))
+            return true;
+    }
+    return false;
+}
+
+/// Whether passing a value of @p type allows the callee to store an address somewhere the caller can see it.
+static bool may_store(const Type* type) {
+    if (auto ptr_type = type->isa<PtrType>())
+        return may_alias(ptr_type->referenced_type());
+    if (auto fn_type = type->isa<FnType>()) {
+        // a function may store the addresses it receives into the variables it captures
+        for (size_t i = 0, e = fn_type->num_ops(); i != e; ++i) {
+            auto op = fn_type->op(i);
+            if (op->isa<FnType>() ? may_store(op) : may_alias(op))
+                return true;
+        }
+        return false;
+    }
+    if (!type->is_known() || type->isa<Var>())
+        return true;
+    for (size_t i = 0, e = type->num_ops(); i != e; ++i) {
+        if (may_store(type->op(i)))
+            return true;
+    }
+    return false;
+}
+
+static const Expr* strip_type_app(const Expr* expr) {
+    if (auto type_app = expr->isa<TypeAppExpr>())
+        return type_app->lhs();
+    return expr;
+}
+
+static const FnDecl* callee_fn_decl(const Expr* callee) {
+    if (auto path = strip_type_app(callee)->isa<PathExpr>())
+        return path->value_decl() ? path->value_decl()->isa<FnDecl>() : nullptr;
+    return nullptr;
+}
+
+static bool is_call(const MapExpr* map) { return map->lhs()->type()->isa<FnType>(); }
+
+/**
+ * The variable an argument like @c &mut a.x(i) borrows from and the path to the borrowed part:
+ * field indices or @c -1 for an index or a dereference.
+ */
+struct Place {
+    const Decl* root = nullptr;
+    std::vector<int> path;
+
+    bool overlaps(const Place& other) const {
+        if (root == nullptr || root != other.root)
+            return false;
+        for (size_t i = 0, e = std::min(path.size(), other.path.size()); i != e; ++i) {
+            if (path[i] != -1 && other.path[i] != -1 && path[i] != other.path[i])
+                return false;
+        }
+        return true;
+    }
+};
+
+static Place place(const Expr* expr) {
+    Place result;
+    while (true) {
+        if (auto prefix = expr->isa<PrefixExpr>()) {
+            if (prefix->kind() == PrefixExpr::MUL)
+                result.path.push_back(-1);
+            else if (prefix->kind() != PrefixExpr::AND)
+                break;
+            expr = prefix->rhs();
+        } else if (auto field = expr->isa<FieldExpr>()) {
+            if (field->field_decl() == nullptr)
+                break;
+            result.path.push_back(field->index());
+            expr = field->lhs();
+        } else if (auto map = expr->isa<MapExpr>()) {
+            if (is_call(map))
+                break;
+            result.path.push_back(-1);
+            expr = map->lhs();
+        } else if (auto cast = expr->isa<CastExpr>()) {
+            expr = cast->src();
+        } else {
+            if (auto path = expr->isa<PathExpr>())
+                result.root = path->value_decl();
+            break;
+        }
+    }
+    std::reverse(result.path.begin(), result.path.end());
+    return result;
+}
+
+//------------------------------------------------------------------------------
+
+typedef std::unordered_set<const Decl*> DeclSet;
+
+/**
+ * Rejects @c &mut arguments which are also used by another argument of the same call
+ * and proves @c &mut parameters to be @c noalias:
+ * A parameter is @c noalias if its function is only called directly and if the argument at each call site
+ * is built from local variables none of which may alias any other argument or anything the callee captures.
+ * Aliasing is approximated flow-insensitively:
+ * Each @c let and each assignment of a value which may hold an address merges the alias classes of all variables involved.
+ */
+class BorrowSema {
+public:
+    /// Tracks all variables mentioned while checking its scope.
+    class Mentions {
+    public:
+        Mentions(BorrowSema& sema)
+            : sema_(sema)
+        {
+            sema_.mentions_.push_back(&decls_);
+        }
+        ~Mentions() { sema_.mentions_.pop_back(); }
+
+        const DeclSet& decls() const { return decls_; }
+
+    private:
+        BorrowSema& sema_;
+        DeclSet decls_;
+    };
+
+    // helpers
+
+    void unite(const DeclSet& decls) {
+        const Decl* first = nullptr;
+        for (auto decl : decls) {
+            if (!is_relevant(decl))
+                continue;
+            if (first)
+                unite(first, decl);
+            else
+                first = decl;
+        }
+    }
+
+    void unite(const LocalDecl* local, const DeclSet& decls) {
+        for (auto decl : decls) {
+            if (is_relevant(decl))
+                unite(local, decl);
+        }
+    }
+
+    static bool is_relevant(const Decl* decl) {
+        auto local = decl->isa<LocalDecl>();
+        return local == nullptr || local->is_address_taken() || may_alias(local->type());
+    }
+    static void locals(const Ptrn*, std::vector<const LocalDecl*>&);
+    void declare(const LocalDecl* local) { owner_[local] = fn_decls_.empty() ? nullptr : fn_decls_.back(); }
+    void mention(const Decl*);
+    void mark_noalias();
+
+    // check wrappers
+
+    void check(const Item* n) { n->check(*this); }
+    void check_fn(const Fn*);
+    void check(const Stmt* n) { n->check(*this); }
+    void check(const Expr* expr) { THORIN_PUSH(is_callee_, false); expr->check(*this); }
+    /// A @p PathExpr checked as @p callee is called directly and does not escape.
+    void check_callee(const Expr* callee) { THORIN_PUSH(is_callee_, true); callee->check(*this); }
+    /// @p arg yields the @c i-th of @p num_args arguments.
+    void check_call(const Expr* callee, size_t num_args, std::function<const Expr*(size_t)> arg);
+
+private:
+    const Decl* find(const Decl* decl) {
+        auto i = parent_.find(decl);
+        if (i == parent_.end() || i->second == decl)
+            return decl;
+        return i->second = find(i->second);
+    }
+
+    void unite(const Decl* a, const Decl* b) {
+        a = find(a);
+        b = find(b);
+        if (a != b)
+            parent_[a] = b;
+    }
+
+    /// A @c &mut parameter at one call site.
+    struct Borrow {
+        const Param* param;
+        DeclSet arg;    ///< Variables the argument is built from.
+        DeclSet others; ///< Variables of the other arguments and the callee.
+    };
+
+    std::unordered_map<const Decl*, const Decl*> parent_;
+    std::unordered_map<const LocalDecl*, const FnDecl*> owner_;
+    std::vector<Borrow> borrows_;
+
+public:
+    std::vector<DeclSet*> mentions_;
+    bool is_callee_ = false;
+    std::vector<const FnDecl*> fn_decls_;
+    std::unordered_set<const FnDecl*> escaped_;
+    std::unordered_set<const FnDecl*> nested_; ///< These may store an address into a variable they capture.
+    std::unordered_set<const Decl*> opaque_; ///< Variables handed to inline assembly.
+    std::vector<const Param*> candidates_;
+    bool has_mut_static_ = false;
+};
+
+void borrow_check(const Module* module) {
+    BorrowSema sema;
+    sema.check(module);
+    sema.mark_noalias();
+}
+
+void BorrowSema::locals(const Ptrn* ptrn, std::vector<const LocalDecl*>& result) {
+    if (auto id = ptrn->isa<IdPtrn>())
+        result.push_back(id->local());
+    else if (auto tuple = ptrn->isa<TuplePtrn>()) {
+        for (const auto& elem : tuple->elems())
+            locals(elem.get(), result);
+    }
+}
+
+void BorrowSema::mention(const Decl* decl) {
+    for (auto decls : mentions_)
+        decls->insert(decl);
+
+    // a nested function aliases the variables it captures
+    if (auto local = decl->isa<LocalDecl>()) {
+        auto i = owner_.find(local);
+        if (i != owner_.end() && !fn_decls_.empty() && i->second != fn_decls_.back() && is_relevant(local))
+            unite(fn_decls_.back(), local);
+    }
+}
+
+void BorrowSema::check_fn(const Fn* fn) {
+    for (const auto& param : fn->params())
+        declare(param.get());
+    check(fn->body());
+}
+
+//------------------------------------------------------------------------------
+
+/*
+ * items
+ */
+
+void Module::check(BorrowSema& sema) const {
+    for (const auto& item : items())
+        sema.check(item.get());
+}
+
+void ModuleDecl::check(BorrowSema&) const {}
+
+void ExternBlock::check(BorrowSema& sema) const {
+    for (const auto& fn_decl : fn_decls())
+        sema.check(fn_decl.get());
+}
+
+void Typedef::check(BorrowSema&) const {}
+void StructDecl::check(BorrowSema&) const {}
+void EnumDecl::check(BorrowSema&) const {}
+
+void StaticItem::check(BorrowSema& sema) const {
+    sema.has_mut_static_ |= is_mut() && may_alias(type());
+    if (init()) {
+        BorrowSema::Mentions mentions(sema);
+        sema.check(init());
+        sema.unite(mentions.decls());
+    }
+}
+
+void FnDecl::check(BorrowSema& sema) const {
+    if (body() == nullptr)
+        return;
+    if (!sema.fn_decls_.empty())
+        sema.nested_.insert(this);
+    sema.fn_decls_.push_back(this);
+    if (!is_extern()) {
+        for (const auto& param : params()) {
+            auto ptr_type = param->type()->isa<MutPtrType>();
+            if (ptr_type && !may_alias(ptr_type->referenced_type()))
+                sema.candidates_.push_back(param.get());
+        }
+    }
+    sema.check_fn(this);
+    sema.fn_decls_.pop_back();
+}
+
+void TraitDecl::check(BorrowSema& sema) const {
+    for (const auto& fn_decl : methods())
+        sema.check(fn_decl.get());
+}
+
+void ImplItem::check(BorrowSema& sema) const {
+    for (const auto& fn_decl : methods())
+        sema.check(fn_decl.get());
+}
+
+//------------------------------------------------------------------------------
+
+/*
+ * expressions
+ */
+
+void EmptyExpr::check(BorrowSema&) const {}
+void LiteralExpr::check(BorrowSema&) const {}
+void CharExpr::check(BorrowSema&) const {}
+void StrExpr::check(BorrowSema&) const {}
+
+void FnExpr::check(BorrowSema& sema) const { sema.check_fn(this); }
+
+void PathExpr::check(BorrowSema& sema) const {
+    if (auto decl = value_decl()) {
+        sema.mention(decl);
+        if (auto fn_decl = decl->isa<FnDecl>()) {
+            if (!sema.is_callee_)
+                sema.escaped_.insert(fn_decl);
+        }
+    }
+}
+
+void PrefixExpr::check(BorrowSema& sema) const {
+    if (kind() == AND && is_mut()) {
+        for (auto e = rhs(); e != nullptr;) {
+            const Expr* through = nullptr;
+            if (auto field = e->isa<FieldExpr>())
+                e = through = field->lhs();
+            else if (auto map = e->isa<MapExpr>())
+                e = is_call(map) ? nullptr : (through = map->lhs());
+            else if (auto deref = e->isa<PrefixExpr>())
+                e = deref->kind() == MUL ? (through = deref->rhs()) : nullptr;
+            else
+                e = nullptr;
+
+            if (through && through->type()->isa<BorrowedPtrType>()) {
+                error(this, "cannot borrow data behind the shared reference '%' as mutable", through);
+                break;
+            }
+        }
+    }
+    sema.check(rhs());
+}
+
+void InfixExpr::check(BorrowSema& sema) const {
+    if (Token::is_assign((TokenKind) kind()) && may_alias(rhs()->type())) {
+        BorrowSema::Mentions mentions(sema);
+        sema.check(lhs());
+        sema.check(rhs());
+        sema.unite(mentions.decls());
+    } else {
+        sema.check(lhs());
+        sema.check(rhs());
+    }
+}
+
+void PostfixExpr::check(BorrowSema& sema) const { sema.check(lhs()); }
+void FieldExpr::check(BorrowSema& sema) const { sema.check(lhs()); }
+void CastExpr::check(BorrowSema& sema) const { sema.check(src()); }
+
+void DefiniteArrayExpr::check(BorrowSema& sema) const {
+    for (const auto& arg : args())
+        sema.check(arg.get());
+}
+
+void RepeatedDefiniteArrayExpr::check(BorrowSema& sema) const { sema.check(value()); }
+void IndefiniteArrayExpr::check(BorrowSema& sema) const { sema.check(dim()); }
+
+void TupleExpr::check(BorrowSema& sema) const {
+    for (const auto& arg : args())
+        sema.check(arg.get());
+}
+
+void SimdExpr::check(BorrowSema& sema) const {
+    for (const auto& arg : args())
+        sema.check(arg.get());
+}
+
+void StructExpr::check(BorrowSema& sema) const {
+    for (const auto& elem : elems())
+        sema.check(elem->expr());
+}
+
+void TypeAppExpr::check(BorrowSema& sema) const {
+    // a type application of a callee is still called directly
+    if (sema.is_callee_)
+        sema.check_callee(lhs());
+    else
+        sema.check(lhs());
+}
+
+void MapExpr::check(BorrowSema& sema) const {
+    if (is_call(this))
+        sema.check_call(lhs(), num_args(), [&] (size_t i) { return arg(i); });
+    else {
+        sema.check(lhs());
+        for (const auto& arg : args())
+            sema.check(arg.get());
+    }
+}
+
+void BlockExprBase::check(BorrowSema& sema) const {
+    for (const auto& stmt : stmts())
+        sema.check(stmt.get());
+    sema.check(expr());
+}
+
+void IfExpr::check(BorrowSema& sema) const {
+    sema.check(cond());
+    sema.check(then_expr());
+    sema.check(else_expr());
+}
+
+void WhileExpr::check(BorrowSema& sema) const {
+    sema.declare(continue_decl());
+    sema.declare(break_decl());
+    sema.check(cond());
+    sema.check(body());
+}
+
+void ForExpr::check(BorrowSema& sema) const {
+    sema.declare(break_decl());
+    auto forexpr = expr();
+    if (auto prefix = forexpr->isa<PrefixExpr>())
+        if (prefix->kind() == PrefixExpr::RUN || prefix->kind() == PrefixExpr::HLT)
+            forexpr = prefix->rhs();
+
+    auto map = forexpr->isa<MapExpr>();
+    if (map && is_call(map)) {
+        // the body is passed as additional last argument
+        auto num_args = map->num_args();
+        sema.check_call(map->lhs(), num_args + 1, [&] (size_t i) { return i == num_args ? fn_expr() : map->arg(i); });
+    } else {
+        sema.check(expr());
+        sema.check(fn_expr());
+    }
+}
+
+void BorrowSema::check_call(const Expr* callee, size_t num_args, std::function<const Expr*(size_t)> arg) {
+    auto fn_type = callee->type()->as<FnType>();
+    auto fn_decl = callee_fn_decl(callee);
+
+    DeclSet all;
+    std::vector<DeclSet> args(num_args + 1); // the callee comes last
+    bool store = false;
+    {
+        Mentions mentions(*this);
+        for (size_t i = 0; i != num_args; ++i) {
+            Mentions arg_mentions(*this);
+            check(arg(i));
+            args[i] = arg_mentions.decls();
+            store |= may_store(arg(i)->type());
+        }
+        Mentions callee_mentions(*this);
+        check_callee(callee);
+        args[num_args] = callee_mentions.decls();
+        store |= fn_decl == nullptr || nested_.count(fn_decl);
+        all = mentions.decls();
+    }
+
+    // the callee may store any address it gets into another argument
+    if (store)
+        unite(all);
+
+    for (size_t i = 0; i != num_args; ++i) {
+        if (i >= fn_type->num_ops() || !fn_type->op(i)->isa<MutPtrType>())
+            continue;
+
+        auto place_i = place(arg(i));
+        for (size_t j = 0; j != num_args; ++j) {
+            if (j < i && j < fn_type->num_ops() && fn_type->op(j)->isa<MutPtrType>())
+                continue; // already reported for argument j
+            if (j != i && may_alias(arg(j)->type()) && place_i.overlaps(place(arg(j)))) {
+                error(arg(i), "cannot borrow '%' as mutable because it is also used by argument % of this call", arg(i), j + 1);
+                break;
+            }
+        }
+
+        if (fn_decl && i < fn_decl->num_params()) {
+            Borrow borrow{fn_decl->param(i), args[i], DeclSet()};
+            for (size_t j = 0; j != num_args + 1; ++j) {
+                if (j != i)
+                    borrow.others.insert(args[j].begin(), args[j].end());
+            }
+            borrows_.emplace_back(std::move(borrow));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+/*
+ * statements
+ */
+
+void ExprStmt::check(BorrowSema& sema) const { sema.check(expr()); }
+
+void ItemStmt::check(BorrowSema& sema) const {
+    // the body of a nested item is not part of the enclosing expression
+    THORIN_PUSH(sema.mentions_, std::vector<DeclSet*>());
+    sema.check(item());
+}
+
+void LetStmt::check(BorrowSema& sema) const {
+    std::vector<const LocalDecl*> lets;
+    BorrowSema::locals(ptrn(), lets);
+    for (auto local : lets)
+        sema.declare(local);
+    if (init()) {
+        BorrowSema::Mentions mentions(sema);
+        sema.check(init());
+        for (auto local : lets) {
+            if (BorrowSema::is_relevant(local))
+                sema.unite(local, mentions.decls());
+        }
+    }
+}
+
+void AsmStmt::check(BorrowSema& sema) const {
+    BorrowSema::Mentions mentions(sema);
+    for (const auto& output : outputs())
+        sema.check(output->expr());
+    for (const auto& input : inputs())
+        sema.check(input->expr());
+    sema.opaque_.insert(mentions.decls().begin(), mentions.decls().end());
+}
+
+//------------------------------------------------------------------------------
+
+/*
+ * noalias
+ */
+
+void BorrowSema::mark_noalias() {
+    if (has_mut_static_)
+        return; // any address may escape into a mutable static and come back from there
+
+    std::unordered_set<const Param*> noalias;
+    for (auto param : candidates_) {
+        auto fn_decl = owner_[param];
+        if (!escaped_.count(fn_decl))
+            noalias.insert(param);
+    }
+
+    // the members of each alias class
+    std::unordered_map<const Decl*, std::vector<const Decl*>> classes;
+    for (const auto& p : parent_) {
+        classes[find(p.first)].push_back(p.first);
+        classes[find(p.second)].push_back(p.second);
+    }
+
+    // collects the parameters a borrow depends on; false if it cannot be proven at all
+    auto depends = [&] (const Borrow& borrow, std::vector<const Param*>& params) {
+        std::unordered_set<const Decl*> roots;
+        for (auto decl : borrow.others) {
+            if (is_relevant(decl))
+                roots.insert(find(decl));
+        }
+
+        for (auto decl : borrow.arg) {
+            if (!is_relevant(decl))
+                continue;
+            auto root = find(decl);
+            if (roots.count(root))
+                return false;
+
+            auto i = classes.find(root);
+            auto members = i == classes.end() ? std::vector<const Decl*>{decl} : i->second;
+            for (auto member : members) {
+                if (opaque_.count(member))
+                    return false;
+                if (auto param = member->isa<Param>()) {
+                    auto owner = owner_.find(param);
+                    if (owner == owner_.end() || owner->second == nullptr || owner->second->body() == nullptr
+                            || !param->type()->isa<MutPtrType>())
+                        return false;
+                    params.push_back(param);
+                } else if (!member->isa<LocalDecl>())
+                    return false;
+            }
+        }
+        return true;
+    };
+
+    std::vector<std::pair<const Param*, std::vector<const Param*>>> requirements;
+    for (const auto& borrow : borrows_) {
+        std::vector<const Param*> params;
+        if (depends(borrow, params))
+            requirements.emplace_back(borrow.param, std::move(params));
+        else
+            noalias.erase(borrow.param);
+    }
+
+    // greatest fixpoint: a parameter stays noalias as long as all parameters its arguments depend on do
+    for (bool todo = true; todo;) {
+        todo = false;
+        for (const auto& requirement : requirements) {
+            if (!noalias.count(requirement.first))
+                continue;
+            for (auto param : requirement.second) {
+                if (!noalias.count(param)) {
+                    noalias.erase(requirement.first);
+                    todo = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (auto param : noalias)
+        param->mark_noalias();
+}
+
+//------------------------------------------------------------------------------
+
+}
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <memory>
+#include <unordered_map>
 
 #include "thorin/util/array.h"
 #include "thorin/util/iterator.h"
@@ -19,6 +21,8 @@ public:
     // helpers
 
     const Type* reduce(const Lambda* lambda, ASTTypeArgs ast_type_args, std::vector<const Type*>& type_args);
+    /// Applies @p lambda to @p type_args - the outermost lambda binds the last one.
+    const Type* instantiate(const Lambda* lambda, const std::vector<const Type*>& type_args);
     void fill_type_args(std::vector<const Type*>& type_args, const ASTTypes& ast_type_args);
     const Type* close(int num_lambdas, const Type* body);
     size_t num_lambdas(const Lambda* lambda);
@@ -68,13 +72,9 @@ public:
         return constrain(ast_type, ast_type->check(*this));
     }
 
-    const Type* check_call(const Expr* lhs, ArrayRef<const Expr*> args, const Type* call_type);
-    const Type* check_call(const Expr* lhs, const Exprs& args, const Type* call_type) {
-        Array<const Expr*> array(args.size());
-        for (size_t i = 0, e = args.size(); i != e; ++i)
-            array[i] = args[i].get();
-        return check_call(lhs, array, call_type);
-    }
+    /// @p arg yields the @c i-th of @p num_args arguments - they are read from the AST in each iteration as @p coerce may wrap them.
+    template<class F>
+    const Type* check_call(const Expr* lhs, size_t num_args, F arg, const Type* call_type);
 
     const FnType* fn_type(const Type* type) {
         if (auto tuple_type = type->isa<TupleType>())
@@ -122,6 +122,21 @@ private:
     TypeMap<std::unique_ptr<Representative>> representatives_;
     bool todo_ = true;
 
+    /// Key of @p reductions_: a @p Lambda plus its type arguments - both hash-consed, so pointer equality suffices.
+    typedef std::vector<const Type*> Reduction;
+    struct ReductionHash {
+        size_t operator()(const Reduction& reduction) const {
+            size_t seed = 0;
+            for (auto type : reduction)
+                seed ^= std::hash<const Type*>()(type) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            return seed;
+        }
+    };
+    std::unordered_map<Reduction, const Type*, ReductionHash> reductions_;
+    size_t num_reduction_hits_ = 0;
+    size_t num_reduction_misses_ = 0;
+    size_t num_reduction_skips_ = 0;
+
     friend void type_inference(Init&, const Module*);
 };
 
@@ -140,17 +155,37 @@ const Type* InferSema::reduce(const Lambda* lambda, ASTTypeArgs ast_type_args, s
         while (type_args.size() < num)
             type_args.push_back(unknown_type());
 
-        size_t i = type_args.size();
-        const Type* type = lambda;
-        while (auto lambda = type->isa<Lambda>())
-            type = app(lambda, type_args[--i]);
+        // the same instantiation is reduced again in each iteration and at each call site - so cache it;
+        // but not with an unknown type argument: that one is fresh, so its key would never be seen again
+        if (std::any_of(type_args.begin(), type_args.end(), [](const Type* type) { return !type->is_known(); })) {
+            ++num_reduction_skips_;
+            return instantiate(lambda, type_args);
+        }
 
-        return type;
+        Reduction key;
+        key.reserve(type_args.size() + 1);
+        key.push_back(lambda);
+        key.insert(key.end(), type_args.begin(), type_args.end());
+        auto p = reductions_.emplace(std::move(key), nullptr);
+        if (!p.second) {
+            ++num_reduction_hits_;
+            return p.first->second;
+        }
+        ++num_reduction_misses_;
+        return p.first->second = instantiate(lambda, type_args);
     }
 
     return type_error();
 }
 
+const Type* InferSema::instantiate(const Lambda* lambda, const std::vector<const Type*>& type_args) {
+    size_t i = type_args.size();
+    const Type* type = lambda;
+    while (auto lambda = type->isa<Lambda>())
+        type = app(lambda, type_args[--i]);
+    return type;
+}
+
 void InferSema::fill_type_args(std::vector<const Type*>& type_args, const ASTTypes& ast_type_args) {
     for (size_t i = 0, e = type_args.size(); i != e; ++i) {
         if (i < ast_type_args.size())
@@ -249,11 +284,13 @@ const Type* InferSema::unify(const Type* dst, const Type* src) {
     if (dst->isa<UnknownType>()) return unify(src_repr, dst_repr)->type;
     if (src->isa<UnknownType>()) return unify(dst_repr, src_repr)->type;
 
-    if (auto dst_borrowed_ptr_type = dst->isa<BorrowedPtrType>()) {
-        if (auto src_owned_ptr_type = src->isa<OwnedPtrType>()) {
-            if (src_owned_ptr_type->addr_space() == dst_borrowed_ptr_type->addr_space()) {
-                auto referenced_type = unify(dst_borrowed_ptr_type->referenced_type(), src_owned_ptr_type->referenced_type());
-                return borrowed_ptr_type(referenced_type, dst_borrowed_ptr_type->addr_space());
+    if (auto dst_ptr_type = dst->isa<PtrType>()) {
+        if (auto src_ptr_type = src->isa<PtrType>()) {
+            if (dst_ptr_type->rank() < src_ptr_type->rank() && src_ptr_type->addr_space() == dst_ptr_type->addr_space()) {
+                auto referenced_type = unify(dst_ptr_type->referenced_type(), src_ptr_type->referenced_type());
+                if (dst->isa<MutPtrType>())
+                    return mut_ptr_type(referenced_type, dst_ptr_type->addr_space(), dst_ptr_type->align());
+                return borrowed_ptr_type(referenced_type, dst_ptr_type->addr_space(), dst_ptr_type->align());
             }
         }
     }
@@ -341,7 +378,8 @@ void type_inference(Init& init, const Module* module) {
         sema->check(module);
     }
 
-    DLOG("iterations needed for type inference: %", i);
+    ILOG("iterations needed for type inference: %", i);
+    ILOG("type reductions: % cache hits, % misses, % not cached", sema->num_reduction_hits_, sema->num_reduction_misses_, sema->num_reduction_skips_);
 }
 
 //------------------------------------------------------------------------------
@@ -388,16 +426,34 @@ const Type* PrimASTType::check(InferSema& sema) const {
 const Type* PtrASTType::check(InferSema& sema) const {
     auto referenced_type = sema.check(referenced_ast_type());
     switch (kind()) {
-        case Borrowed: return sema.borrowed_ptr_type(referenced_type, addr_space());
-        case Mut:      return sema.     mut_ptr_type(referenced_type, addr_space());
-        case Owned:    return sema.   owned_ptr_type(referenced_type, addr_space());
+        case Borrowed: return sema.borrowed_ptr_type(referenced_type, addr_space(), align());
+        case Mut:      return sema.     mut_ptr_type(referenced_type, addr_space(), align());
+        case Owned:    return sema.   owned_ptr_type(referenced_type, addr_space(), align());
     }
     THORIN_UNREACHABLE;
 }
 
 const Type* IndefiniteArrayASTType::check(InferSema& sema) const { return sema.indefinite_array_type(sema.check(elem_ast_type())); }
 const Type* DefiniteArrayASTType::check(InferSema& sema) const { return sema.definite_array_type(sema.check(elem_ast_type()), dim()); }
-const Type* SimdASTType::check(InferSema& sema) const { return sema.simd_type(sema.check(elem_ast_type()), size()); }
+/// Number of lanes of @p elem_type which fit into a vector register of @p native_simd_width bits.
+static uint64_t native_lanes(const Type* elem_type) {
+    uint64_t bits;
+    switch (elem_type->kind()) {
+        case PrimType_bool:
+        case PrimType_i8:  case PrimType_u8:                    bits =  8; break;
+        case PrimType_i16: case PrimType_u16: case PrimType_f16:
+        case PrimType_bf16:                                     bits = 16; break;
+        case PrimType_i32: case PrimType_u32: case PrimType_f32: bits = 32; break;
+        case PrimType_i64: case PrimType_u64: case PrimType_f64: bits = 64; break;
+        default: return 1; // TypeSema complains
+    }
+    return std::max(uint64_t(native_simd_width()) / bits, uint64_t(1));
+}
+
+const Type* SimdASTType::check(InferSema& sema) const {
+    auto elem_type = sema.check(elem_ast_type());
+    return sema.simd_type(elem_type, is_native() ? native_lanes(elem_type) : size());
+}
 
 const Type* TupleASTType::check(InferSema& sema) const {
     Array<const Type*> types(num_ast_type_args());
@@ -572,7 +628,7 @@ const Type* PathExpr::check(InferSema& sema) const {
 
 const Type* PrefixExpr::check(InferSema& sema) const {
     switch (kind()) {
-        case AND:   return sema.borrowed_ptr_type(sema.check(rhs()), 0);
+        case AND:   return is_mut() ? sema.mut_ptr_type(sema.check(rhs()), 0) : sema.borrowed_ptr_type(sema.check(rhs()), 0);
         case TILDE: return sema.   owned_ptr_type(sema.check(rhs()), 0);
         case MUL: {
             auto type = sema.check(rhs());
@@ -594,6 +650,19 @@ const Type* PrefixExpr::check(InferSema& sema) const {
     THORIN_UNREACHABLE;
 }
 
+/// A scalar operand of a lane-wise operator is broadcast to all lanes of the other, simd operand.
+static bool is_broadcast(const Type* simd, const Type* scalar) {
+    return simd->isa<SimdType>() && scalar->isa<PrimType>();
+}
+
+/**
+ * Whether it is still open if a lane-wise operator broadcasts - one operand is simd but the type of the other is unknown.
+ * Neither operand is constrained then; a later iteration decides once both types are known.
+ */
+static bool is_undecided(const Type* ltype, const Type* rtype) {
+    return (ltype->isa<SimdType>() && rtype->isa<UnknownType>()) || (rtype->isa<SimdType>() && ltype->isa<UnknownType>());
+}
+
 const Type* InfixExpr::check(InferSema& sema) const {
     switch (kind()) {
         case EQ: case NE:
@@ -601,6 +670,10 @@ const Type* InfixExpr::check(InferSema& sema) const {
         case GT: case GE: {
             auto ltype = sema.check(lhs());
             auto rtype = sema.check(rhs());
+            if (is_broadcast(ltype, rtype) || is_broadcast(rtype, ltype) || is_undecided(ltype, rtype)) {
+                auto simd = (ltype->isa<SimdType>() ? ltype : rtype)->as<SimdType>();
+                return sema.simd_type(sema.type_bool(), simd->dim());
+            }
             sema.constrain(lhs(), rtype);
             sema.constrain(rhs(), ltype);
             if (auto simd = rhs()->type()->isa<SimdType>())
@@ -608,16 +681,34 @@ const Type* InfixExpr::check(InferSema& sema) const {
             return rhs()->type()->is_known() ? sema.type_bool() : sema.find_type(this);
         }
         case OROR:
-        case ANDAND:
-            sema.check(lhs(), sema.type_bool());
-            sema.check(rhs(), sema.type_bool());
+        case ANDAND: {
+            // lane-wise on masks - both sides are evaluated
+            auto ltype = sema.check(lhs());
+            auto rtype = sema.check(rhs());
+            if (ltype->isa<SimdType>() || rtype->isa<SimdType>()) {
+                if (is_broadcast(ltype, rtype) || is_undecided(ltype, rtype))
+                    return ltype->isa<SimdType>() ? ltype : rtype;
+                if (is_broadcast(rtype, ltype))
+                    return rtype;
+                sema.constrain(lhs(), rtype);
+                return sema.constrain(rhs(), ltype);
+            }
+            sema.constrain(lhs(), sema.type_bool());
+            sema.constrain(rhs(), sema.type_bool());
             return sema.type_bool();
+        }
         case ADD: case SUB:
         case MUL: case DIV: case REM:
         case SHL: case SHR:
         case AND: case OR:  case XOR: {
             auto ltype = sema.check(lhs());
             auto rtype = sema.check(rhs());
+            if (is_broadcast(ltype, rtype))
+                return ltype;
+            if (is_broadcast(rtype, ltype))
+                return rtype;
+            if (is_undecided(ltype, rtype))
+                return ltype->isa<SimdType>() ? ltype : rtype;
             sema.constrain(lhs(), rtype);
             sema.constrain(rhs(), ltype);
             return rhs()->type();
@@ -627,8 +718,10 @@ const Type* InfixExpr::check(InferSema& sema) const {
         case MUL_ASGN: case DIV_ASGN: case REM_ASGN:
         case SHL_ASGN: case SHR_ASGN:
         case AND_ASGN: case  OR_ASGN: case XOR_ASGN: {
-            sema.check(lhs());
-            sema.check(rhs());
+            auto ltype = sema.check(lhs());
+            auto rtype = sema.check(rhs());
+            if (kind() != ASGN && (is_broadcast(ltype, rtype) || is_undecided(ltype, rtype)))
+                return sema.unit();
             sema.coerce(lhs(), rhs());
             return sema.unit();
         }
@@ -713,26 +806,32 @@ const Type* StructExpr::check(InferSema& sema) const {
     return type;
 }
 
-const Type* InferSema::check_call(const Expr* lhs, ArrayRef<const Expr*> args, const Type* call_type) {
+template<class F>
+const Type* InferSema::check_call(const Expr* lhs, size_t num_args, F arg, const Type* call_type) {
     auto fn_type = lhs->type()->as<FnType>();
 
-    for (const auto& arg : args)
-        check(arg);
+    for (size_t i = 0; i != num_args; ++i)
+        check(arg(i));
+
+    if (num_args == fn_type->num_ops() || num_args+1 == fn_type->num_ops()) {
+        // once the types of the arguments are settled the callee type does not change anymore - don't rebuild it then;
+        // types stays empty - and allocates nothing - until the first argument type differs from its parameter type
+        std::vector<const Type*> types;
+        for (size_t i = 0; i != num_args; ++i) {
+            auto type = coerce(fn_type->op(i), arg(i));
+            if (types.empty() && type != fn_type->op(i))
+                types.assign(fn_type->ops().begin(), fn_type->ops().end());
+            if (!types.empty())
+                types[i] = type;
+        }
 
-    if (args.size() == fn_type->num_ops()) {
-        Array<const Type*> types(args.size());
-        for (size_t i = 0, e = args.size(); i != e; ++i)
-            types[i] = coerce(fn_type->op(i), args[i]);
-        constrain(lhs, this->fn_type(types));
-        return type_noret();
-    }
+        if (num_args == fn_type->num_ops()) {
+            if (!types.empty())
+                constrain(lhs, this->fn_type(types));
+            return type_noret();
+        }
 
-    if (args.size()+1 == fn_type->num_ops()) {
-        Array<const Type*> types(args.size()+1);
-        for (size_t i = 0, e = args.size(); i != e; ++i)
-            types[i] = coerce(fn_type->op(i), args[i]);
-        types.back() = fn_type->ops().back();
-        auto result = constrain(lhs, this->fn_type(types));
+        auto result = types.empty() ? lhs->type() : constrain(lhs, this->fn_type(types));
         if (auto fn_type = result->isa<FnType>())
             return fn_type->return_type();
         else
@@ -750,8 +849,11 @@ const Type* FieldExpr::check(InferSema& sema) const {
     }
 
     if (auto struct_type = ltype->isa<StructType>()) {
-        if (auto field_decl = struct_type->struct_decl()->field_decl(symbol()))
-            return struct_type->op(field_decl->index());
+        // a known struct type is fixed, so is the field - look it up only once
+        if (field_decl_ == nullptr)
+            field_decl_ = struct_type->struct_decl()->field_decl(symbol());
+        if (field_decl_)
+            return struct_type->op(field_decl_->index());
     }
 
     return ltype->is_known() ? sema.type_error() : sema.find_type(this);
@@ -798,7 +900,7 @@ const Type* MapExpr::check(InferSema& sema) const {
     }
 
     if (ltype->isa<FnType>())
-        return sema.check_call(lhs(), args(), type_);
+        return sema.check_call(lhs(), num_args(), [&] (size_t i) { return arg(i); }, type_);
 
     for (int i = 0, n = num_args(); i < n; i++) sema.check(arg(i));
 
@@ -862,12 +964,9 @@ const Type* ForExpr::check(InferSema& sema) const {
                     sema.constrain(break_decl_.get(), fn_ret); // inherit the type for break
             }
 
-            // copy over args and check call
-            Array<const Expr*> args(map->num_args() + 1);
-            for (size_t i = 0, e = map->num_args(); i != e; ++i)
-                args[i] = map->arg(i);
-            args.back() = fn_expr();
-            return sema.check_call(map->lhs(), args, type_);
+            // the body is passed as additional last argument
+            auto num_args = map->num_args();
+            return sema.check_call(map->lhs(), num_args + 1, [&] (size_t i) { return i == num_args ? fn_expr() : map->arg(i); }, type_);
         }
 
         for (size_t i = 0, e = map->num_args(); i != e; ++i)
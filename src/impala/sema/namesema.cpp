@@ -227,6 +227,13 @@ void Fn::fn_check(NameSema& sema) const {
 }
 
 void FnDecl::check(NameSema& sema) const {
+    if (is_extern() && abi() == "\"thorin\"") {
+        auto name = fn_symbol().remove_quotation();
+#define IMPALA_INTRINSIC(intrinsic) \
+        if (name == #intrinsic) intrinsic_ = Intrinsic_##intrinsic;
+#include "impala/intrinsiclist.h"
+    }
+
     fn_check(sema);
 }
 
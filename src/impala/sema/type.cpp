@@ -63,10 +63,14 @@ bool is_subtype(const Type* dst, const Type* src) {
     if (dst == src)
         return true;
 
-    if (auto dst_borrowed_ptr_type = dst->isa<BorrowedPtrType>()) {
-        if (auto src_owned_ptr_type = src->isa<OwnedPtrType>())
-            return src_owned_ptr_type->addr_space() == dst_borrowed_ptr_type->addr_space()
-                && is_subtype(dst_borrowed_ptr_type->referenced_type(), src_owned_ptr_type->referenced_type());
+    if (auto dst_ptr_type = dst->isa<PtrType>()) {
+        if (auto src_ptr_type = src->isa<PtrType>()) {
+            if (dst_ptr_type->rank() < src_ptr_type->rank() || dst_ptr_type->align() != src_ptr_type->align())
+                return dst_ptr_type->rank() <= src_ptr_type->rank()
+                    && dst_ptr_type->align() <= src_ptr_type->align()
+                    && src_ptr_type->addr_space() == dst_ptr_type->addr_space()
+                    && is_subtype(dst_ptr_type->referenced_type(), src_ptr_type->referenced_type());
+        }
     }
 
     if (auto dst_indefinite_array_type = dst->isa<IndefiniteArrayType>()) {
@@ -105,7 +109,7 @@ bool is_subtype(const Type* dst, const Type* src) {
  */
 
 uint64_t PtrType::vhash() const {
-    return thorin::hash_combine(Type::vhash(), (uint64_t)addr_space());
+    return thorin::hash_combine(thorin::hash_combine(Type::vhash(), (uint64_t)addr_space()), (uint64_t)align());
 }
 
 //------------------------------------------------------------------------------
@@ -118,7 +122,7 @@ bool PtrType::equal(const Type* other) const {
     if (!Type::equal(other))
         return false;
     auto ptr = other->as<PtrType>();
-    return ptr->addr_space() == addr_space();
+    return ptr->addr_space() == addr_space() && ptr->align() == align();
 }
 
 bool UnknownType::equal(const Type* other) const { return this == other; }
@@ -162,6 +166,8 @@ std::ostream& PtrType::stream(std::ostream& os) const {
     os << prefix();
     if (addr_space() != 0)
         os << '[' << addr_space() << ']';
+    if (align() != 0)
+        os << "align(" << align() << ") ";
     return os << referenced_type();
 }
 
@@ -190,9 +196,9 @@ const Type* FnType             ::vrebuild(TypeTable& to, Types ops) const { retu
 const Type* DefiniteArrayType  ::vrebuild(TypeTable& to, Types ops) const { return to.  definite_array_type(ops[0], dim()); }
 const Type* SimdType           ::vrebuild(TypeTable& to, Types ops) const { return to.            simd_type(ops[0], dim()); }
 const Type* IndefiniteArrayType::vrebuild(TypeTable& to, Types ops) const { return to.indefinite_array_type(ops[0]); }
-const Type* BorrowedPtrType    ::vrebuild(TypeTable& to, Types ops) const { return to.borrowed_ptr_type(ops[0], addr_space()); }
-const Type* MutPtrType         ::vrebuild(TypeTable& to, Types ops) const { return to.     mut_ptr_type(ops[0], addr_space()); }
-const Type* OwnedPtrType       ::vrebuild(TypeTable& to, Types ops) const { return to.   owned_ptr_type(ops[0], addr_space()); }
+const Type* BorrowedPtrType    ::vrebuild(TypeTable& to, Types ops) const { return to.borrowed_ptr_type(ops[0], addr_space(), align()); }
+const Type* MutPtrType         ::vrebuild(TypeTable& to, Types ops) const { return to.     mut_ptr_type(ops[0], addr_space(), align()); }
+const Type* OwnedPtrType       ::vrebuild(TypeTable& to, Types ops) const { return to.   owned_ptr_type(ops[0], addr_space(), align()); }
 const Type* NoRetType          ::vrebuild(TypeTable&,    Types     ) const { return this; }
 const Type* UnknownType        ::vrebuild(TypeTable&,    Types     ) const { return this; }
 
@@ -215,15 +221,15 @@ const Type* IndefiniteArrayType::vreduce(int depth, const Type* type, Type2Type&
 }
 
 const Type* BorrowedPtrType::vreduce(int depth, const Type* type, Type2Type& map) const {
-    return typetable().borrowed_ptr_type(referenced_type()->reduce(depth, type, map), addr_space());
+    return typetable().borrowed_ptr_type(referenced_type()->reduce(depth, type, map), addr_space(), align());
 }
 
 const Type* MutPtrType::vreduce(int depth, const Type* type, Type2Type& map) const {
-    return typetable().mut_ptr_type(referenced_type()->reduce(depth, type, map), addr_space());
+    return typetable().mut_ptr_type(referenced_type()->reduce(depth, type, map), addr_space(), align());
 }
 
 const Type* OwnedPtrType::vreduce(int depth, const Type* type, Type2Type& map) const {
-    return typetable().owned_ptr_type(referenced_type()->reduce(depth, type, map), addr_space());
+    return typetable().owned_ptr_type(referenced_type()->reduce(depth, type, map), addr_space(), align());
 }
 
 const Type* FnType::vreduce(int depth, const Type* type, Type2Type& map) const {
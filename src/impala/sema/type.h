@@ -80,7 +80,7 @@ private:
 bool is(const Type*, PrimTypeKind kind);
 #define IMPALA_TYPE(itype, atype) inline bool is_##itype(const Type* t) { return is(t, PrimType_##itype); }
 #include "impala/tokenlist.h"
-inline bool is_float(const Type* t) { return             is_f16(t) || is_f32(t) || is_f64(t); }
+inline bool is_float(const Type* t) { return is_bf16(t) || is_f16(t) || is_f32(t) || is_f64(t); }
 inline bool is_int  (const Type* t) { return is_i8(t) || is_i16(t) || is_i32(t) || is_i64(t)
                                           || is_u8(t) || is_u16(t) || is_u32(t) || is_u64(t); }
 bool is_void(const Type*);
@@ -91,9 +91,10 @@ bool is_subtype(const Type* dst, const Type* src);
 /// Pointer @p Type.
 class PtrType : public Type {
 protected:
-    PtrType(TypeTable& typetable, int kind, const Type* referenced_type, int addr_space)
+    PtrType(TypeTable& typetable, int kind, const Type* referenced_type, int addr_space, unsigned align)
         : Type(typetable, kind, {referenced_type})
         , addr_space_(addr_space)
+        , align_(align)
     {}
 
     std::ostream& stream_ptr_type(std::ostream&, std::string prefix, int addr_space, const Type* ref_type) const;
@@ -101,6 +102,10 @@ protected:
 public:
     const Type* referenced_type() const { return op(0); }
     int addr_space() const { return addr_space_; }
+    /// The guaranteed alignment of the address in bytes; 0 if only the natural alignment is known.
+    unsigned align() const { return align_; }
+    /// A pointer coerces to a pointer of lower rank: @c ~T to @c &mut T to @c &T.
+    int rank() const { return kind() == Kind_owned_ptr ? 2 : kind() == Kind_mut_ptr ? 1 : 0; }
 
     virtual std::ostream& stream(std::ostream&) const override;
     virtual uint64_t vhash() const override;
@@ -109,14 +114,15 @@ public:
 
 private:
     int addr_space_;
+    unsigned align_;
 
     friend class TypeTable;
 };
 
 class BorrowedPtrType : public PtrType {
 public:
-    BorrowedPtrType(TypeTable& typetable, const Type* referenced_type, int addr_space)
-        : PtrType(typetable, Kind_borrowed_ptr, referenced_type, addr_space)
+    BorrowedPtrType(TypeTable& typetable, const Type* referenced_type, int addr_space, unsigned align)
+        : PtrType(typetable, Kind_borrowed_ptr, referenced_type, addr_space, align)
     {}
 
     virtual std::string prefix() const override { return "&"; }
@@ -128,8 +134,8 @@ private:
 
 class MutPtrType : public PtrType {
 public:
-    MutPtrType(TypeTable& typetable, const Type* referenced_type, int addr_space)
-        : PtrType(typetable, Kind_mut_ptr, referenced_type, addr_space)
+    MutPtrType(TypeTable& typetable, const Type* referenced_type, int addr_space, unsigned align)
+        : PtrType(typetable, Kind_mut_ptr, referenced_type, addr_space, align)
     {}
 
     virtual std::string prefix() const override { return "&mut"; }
@@ -141,8 +147,8 @@ private:
 
 class OwnedPtrType : public PtrType {
 public:
-    OwnedPtrType(TypeTable& typetable, const Type* referenced_type, int addr_space)
-        : PtrType(typetable, Kind_owned_ptr, referenced_type, addr_space)
+    OwnedPtrType(TypeTable& typetable, const Type* referenced_type, int addr_space, unsigned align)
+        : PtrType(typetable, Kind_owned_ptr, referenced_type, addr_space, align)
     {}
 
     virtual std::string prefix() const override { return "~"; }
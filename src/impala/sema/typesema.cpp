@@ -2,6 +2,7 @@
 
 #include "impala/ast.h"
 #include "impala/impala.h"
+#include "impala/target.h"
 #include "impala/sema/typetable.h"
 
 using namespace thorin;
@@ -52,10 +53,11 @@ public:
 
     template<typename... Args>
     void expect_lvalue(const Expr* expr, const char* fmt, Args... args) {
-        std::ostringstream os;
-        thorin::streamf(os, fmt, args...);
-        if (!expr->is_lvalue())
+        if (!expr->is_lvalue()) {
+            std::ostringstream os;
+            thorin::streamf(os, fmt, args...);
             error(expr, "lvalue required for %", os.str());
+        }
     }
 
     void expect_known(const Decl* value_decl) {
@@ -83,13 +85,9 @@ public:
     const Type* check(const Expr* expr) { expr->check(*this); return expr->type(); }
     const Type* check(const Ptrn* p) { p->check(*this); return p->type(); }
     void check(const Stmt* n) { n->check(*this); }
-    void check_call(const Expr* expr, ArrayRef<const Expr*> args);
-    void check_call(const Expr* expr, const Exprs& args) {
-        Array<const Expr*> array(args.size());
-        for (size_t i = 0, e = args.size(); i != e; ++i)
-            array[i] = args[i].get();
-        check_call(expr, array);
-    }
+    /// @p arg yields the @c i-th of @p num_args arguments.
+    template<class F>
+    void check_call(const Expr* expr, size_t num_args, F arg);
 
 private:
     bool nossa_;
@@ -233,6 +231,15 @@ void FnDecl::check(TypeSema& sema) const {
 
     if (body() != nullptr)
         check_body(sema);
+
+    if (has_target_clones()) {
+        if (!ast_type_params().empty())
+            error(this, "polymorphic function '%' cannot have target clones", symbol());
+        for (const auto& feature : target_clones()) {
+            if (target_feature(feature) == Num_TargetFeatures)
+                error(this, "unknown target feature '%' in target_clones attribute", feature);
+        }
+    }
 }
 
 void StaticItem::check(TypeSema& sema) const {
@@ -301,7 +308,7 @@ void PrefixExpr::check(TypeSema& sema) const {
 
     switch (kind()) {
         case AND:
-            sema.expect_lvalue(rhs(), "as unary '&' operand");
+            sema.expect_lvalue(rhs(), is_mut() ? "as unary '&mut' operand" : "as unary '&' operand");
             rhs()->take_address();
             return;
         case TILDE:
@@ -333,11 +340,21 @@ void PrefixExpr::check(TypeSema& sema) const {
     THORIN_UNREACHABLE;
 }
 
+/// A scalar operand of a lane-wise operator is broadcast to all lanes of the other, simd operand.
+static bool is_broadcast(const Type* simd, const Type* scalar) {
+    if (auto simd_type = simd->isa<SimdType>())
+        return simd_type->elem_type() == scalar;
+    return false;
+}
+
 void InfixExpr::check(TypeSema& sema) const {
     sema.check(lhs());
     sema.check(rhs());
 
-    if (lhs()->type() != rhs()->type() && !lhs()->type()->isa<TypeError>() && !rhs()->type()->isa<TypeError>()) {
+    bool broadcast = kind() != ASGN && (is_broadcast(lhs()->type(), rhs()->type())
+                                     || (!Token::is_assign(token_kind(this)) && is_broadcast(rhs()->type(), lhs()->type())));
+
+    if (lhs()->type() != rhs()->type() && !broadcast && !lhs()->type()->isa<TypeError>() && !rhs()->type()->isa<TypeError>()) {
         error(this, "both left-hand side and right-hand side of expression must agree on the same type");
         error(lhs(),  "left-hand side type is '%'", lhs()->type());
         error(rhs(), "right-hand side type is '%'", rhs()->type());
@@ -509,13 +526,165 @@ void FieldExpr::check(TypeSema& sema) const {
 void TypeAppExpr::check(TypeSema& /*sema*/) const {
 }
 
+static const FnDecl* callee_decl(const Expr* callee) {
+    if (auto type_app = callee->isa<TypeAppExpr>())
+        callee = type_app->lhs();
+    if (auto path = callee->isa<PathExpr>())
+        return path->value_decl() ? path->value_decl()->isa<FnDecl>() : nullptr;
+    return nullptr;
+}
+
+/// The least and the greatest number of arguments of @p intrinsic - trailing memory orderings of atomics may be omitted.
+static std::pair<size_t, size_t> num_intrinsic_args(FnDecl::Intrinsic intrinsic) {
+    switch (intrinsic) {
+        case FnDecl::Intrinsic_sizeof:
+        case FnDecl::Intrinsic_simd_lanes:     return {0, 0};
+        case FnDecl::Intrinsic_bitcast:
+        case FnDecl::Intrinsic_broadcast:
+        case FnDecl::Intrinsic_hadd:
+        case FnDecl::Intrinsic_hmin:
+        case FnDecl::Intrinsic_hmax:
+        case FnDecl::Intrinsic_rsqrt:          return {1, 1};
+        case FnDecl::Intrinsic_assume_aligned: return {2, 2};
+        case FnDecl::Intrinsic_select:
+        case FnDecl::Intrinsic_shuffle:
+        case FnDecl::Intrinsic_fma:
+        case FnDecl::Intrinsic_masked_load:
+        case FnDecl::Intrinsic_masked_store:   return {3, 3};
+        case FnDecl::Intrinsic_gather:
+        case FnDecl::Intrinsic_scatter:        return {4, 4};
+        case FnDecl::Intrinsic_fence:          return {0, 1};
+        case FnDecl::Intrinsic_atomic_load:    return {1, 2};
+        case FnDecl::Intrinsic_atomic_store:   return {2, 3};
+        case FnDecl::Intrinsic_atomic:         return {3, 4};
+        case FnDecl::Intrinsic_cmpxchg:
+        case FnDecl::Intrinsic_cmpxchg_weak:   return {3, 5};
+        default:                               return {0, size_t(-1)};
+    }
+}
+
+/**
+ * The declarations of the simd, math, memory and atomic intrinsics are polymorphic - the number of arguments and the
+ * relations between the operands are checked here.
+ */
+static void check_simd_intrinsic(const MapExpr* map, const FnDecl* fn_decl) {
+    auto intrinsic = fn_decl ? fn_decl->intrinsic() : FnDecl::NoIntrinsic;
+    auto num = num_intrinsic_args(intrinsic);
+    if (map->num_args() < num.first || map->num_args() > num.second) {
+        if (num.first == num.second)
+            error(map, "intrinsic '%' requires % arguments but found %", fn_decl->symbol(), num.first, map->num_args());
+        else
+            error(map, "intrinsic '%' requires % to % arguments but found %", fn_decl->symbol(), num.first, num.second, map->num_args());
+        return;
+    }
+
+    switch (intrinsic) {
+        case FnDecl::Intrinsic_shuffle: {
+            auto simd_type = map->arg(0)->type()->isa<SimdType>();
+            if (simd_type == nullptr) {
+                error(map->arg(0), "shuffle requires simd vectors but found '%'", map->arg(0)->type());
+                return;
+            }
+            auto mask = map->arg(2)->isa<SimdExpr>();
+            if (mask == nullptr || mask->num_args() != simd_type->dim()) {
+                error(map->arg(2), "shuffle requires a simd literal of % lane indices as mask", simd_type->dim());
+                return;
+            }
+            for (const auto& index : mask->args()) {
+                auto lit = index->isa<LiteralExpr>();
+                if (lit == nullptr || !is_int(lit->type()) || lit->get_u64() >= 2 * simd_type->dim())
+                    error(index.get(), "shuffle mask requires integer literals below %", 2 * simd_type->dim());
+            }
+            break;
+        }
+        case FnDecl::Intrinsic_broadcast: {
+            auto simd_type = map->type()->isa<SimdType>();
+            if (simd_type == nullptr || simd_type->elem_type() != map->arg(0)->type())
+                error(map, "broadcast of '%' requires a simd vector of '%' as result but found '%'", map->arg(0)->type(), map->arg(0)->type(), map->type());
+            break;
+        }
+        case FnDecl::Intrinsic_hadd:
+        case FnDecl::Intrinsic_hmin:
+        case FnDecl::Intrinsic_hmax: {
+            auto simd_type = map->arg(0)->type()->isa<SimdType>();
+            if (simd_type == nullptr || simd_type->elem_type() != map->type())
+                error(map, "horizontal reduction to '%' requires a simd vector of '%' but found '%'", map->type(), map->type(), map->arg(0)->type());
+            else if (!is_int(map->type()) && !is_float(map->type()))
+                error(map, "horizontal reduction requires a simd vector of numbers but found '%'", map->arg(0)->type());
+            break;
+        }
+        case FnDecl::Intrinsic_fma:
+        case FnDecl::Intrinsic_rsqrt: {
+            auto simd_type = map->type()->isa<SimdType>();
+            auto elem_type = simd_type ? simd_type->elem_type() : map->type();
+            if (!is_float(elem_type) || is_bf16(elem_type))
+                error(map, "% requires 'f16', 'f32' or 'f64' operands but found '%'", intrinsic == FnDecl::Intrinsic_fma ? "fma" : "rsqrt", map->type());
+            break;
+        }
+        case FnDecl::Intrinsic_simd_lanes: {
+            auto type_app = map->lhs()->isa<TypeAppExpr>();
+            if (type_app == nullptr || type_app->num_type_args() != 1 || !type_app->type_arg(0)->isa<SimdType>())
+                error(map, "simd_lanes requires a simd type as type argument");
+            else if (!is_i32(map->type()))
+                error(map, "simd_lanes yields 'i32' but found '%'", map->type());
+            break;
+        }
+        case FnDecl::Intrinsic_masked_load:
+        case FnDecl::Intrinsic_masked_store:
+        case FnDecl::Intrinsic_gather:
+        case FnDecl::Intrinsic_scatter: {
+            bool indexed = intrinsic == FnDecl::Intrinsic_gather || intrinsic == FnDecl::Intrinsic_scatter;
+            auto mask = map->arg(indexed ? 2 : 1);
+            auto vec  = map->arg(indexed ? 3 : 2);
+            auto mask_type = mask->type()->isa<SimdType>();
+            auto vec_type  = vec->type()->isa<SimdType>();
+            if (mask_type == nullptr || !is_bool(mask_type->elem_type())) {
+                error(mask, "masked memory access requires a simd vector of 'bool' as mask but found '%'", mask->type());
+                return;
+            }
+            if (vec_type == nullptr || vec_type->dim() != mask_type->dim()) {
+                error(vec, "masked memory access requires a simd vector of % lanes but found '%'", mask_type->dim(), vec->type());
+                return;
+            }
+
+            auto ptr_type = map->arg(0)->type()->isa<PtrType>();
+            auto referenced_type = ptr_type ? ptr_type->referenced_type() : nullptr;
+            if (indexed) {
+                auto indices_type = map->arg(1)->type()->isa<SimdType>();
+                if (indices_type == nullptr || !is_int(indices_type->elem_type()) || indices_type->dim() != mask_type->dim())
+                    error(map->arg(1), "% requires a simd vector of % integers as indices but found '%'",
+                          intrinsic == FnDecl::Intrinsic_gather ? "gather" : "scatter", mask_type->dim(), map->arg(1)->type());
+                auto array_type = referenced_type ? referenced_type->isa<ArrayType>() : nullptr;
+                if (array_type == nullptr || array_type->isa<SimdType>() || array_type->elem_type() != vec_type->elem_type())
+                    error(map->arg(0), "% requires a pointer to an array of '%' but found '%'",
+                          intrinsic == FnDecl::Intrinsic_gather ? "gather" : "scatter", vec_type->elem_type(), map->arg(0)->type());
+            } else if (referenced_type != vec_type) {
+                error(map->arg(0), "masked memory access requires a pointer to '%' but found '%'", vec_type, map->arg(0)->type());
+            }
+            break;
+        }
+        case FnDecl::Intrinsic_assume_aligned: {
+            if (!map->arg(0)->type()->isa<PtrType>())
+                error(map->arg(0), "assume_aligned requires a pointer but found '%'", map->arg(0)->type());
+            auto lit = map->arg(1)->isa<LiteralExpr>();
+            auto align = lit && is_int(lit->type()) ? lit->get_u64() : 0;
+            if (align == 0 || (align & (align - 1)) != 0)
+                error(map->arg(1), "assume_aligned requires a power of two as integer literal");
+            break;
+        }
+        default:
+            break;
+    }
+}
+
 void MapExpr::check(TypeSema& sema) const {
     auto ltype = sema.check(lhs());
     for (const auto& arg : args())
         sema.check(arg.get());
 
     if (ltype->isa<FnType>()) {
-        sema.check_call(lhs(), args());
+        sema.check_call(lhs(), num_args(), [&] (size_t i) { return arg(i); });
+        check_simd_intrinsic(this, callee_decl(lhs()));
     } else if (ltype->isa<ArrayType>()) {
         if (num_args() == 1)
             sema.expect_int(arg(0), "for array subscript");
@@ -537,14 +706,15 @@ void MapExpr::check(TypeSema& sema) const {
         error(this, "incorrect type for map expression");
 }
 
-void TypeSema::check_call(const Expr* expr, ArrayRef<const Expr*> args) {
+template<class F>
+void TypeSema::check_call(const Expr* expr, size_t num_args, F arg) {
     auto fn_type = expr->type()->as<FnType>();
 
-    if (fn_type->num_ops() == args.size() || fn_type->num_ops() == args.size() + 1) {
-        for (size_t i = 0; i < args.size(); i++)
-            expect_type(fn_type->op(i), args[i], "argument type");
+    if (fn_type->num_ops() == num_args || fn_type->num_ops() == num_args + 1) {
+        for (size_t i = 0; i < num_args; i++)
+            expect_type(fn_type->op(i), arg(i), "argument type");
     } else
-        error(expr, "incorrect number of arguments in function application: got %, expected %", args.size(), fn_type->num_ops() - 1);
+        error(expr, "incorrect number of arguments in function application: got %, expected %", num_args, fn_type->num_ops() - 1);
 }
 
 void BlockExprBase::check(TypeSema& sema) const {
@@ -592,13 +762,9 @@ void ForExpr::check(TypeSema& sema) const {
         if (auto fn_for = ltype->isa<FnType>()) {
             if (fn_for->num_ops() != 0) {
                 if (fn_for->ops().back()->isa<FnType>()) {
-                    // TODO remove copy & paste code
-                    // copy over args and check call --
-                    Array<const Expr*> args(map->num_args() + 1);
-                    for (size_t i = 0, e = map->num_args(); i != e; ++i)
-                        args[i] = map->arg(i);
-                    args.back() = fn_expr();
-                    sema.check_call(map->lhs(), args);
+                    // the body is passed as additional last argument
+                    auto num_args = map->num_args();
+                    sema.check_call(map->lhs(), num_args + 1, [&] (size_t i) { return i == num_args ? fn_expr() : map->arg(i); });
                     return;
                 }
             }
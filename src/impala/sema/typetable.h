@@ -13,8 +13,8 @@ public:
 
 #define IMPALA_TYPE(itype, atype) const PrimType* type_##itype() { return itype##_; }
 #include "impala/tokenlist.h"
-    const BorrowedPtrType* borrowed_ptr_type(const Type* referenced_type, int addr_space = 0) {
-        return unify(new BorrowedPtrType(*this, referenced_type, addr_space));
+    const BorrowedPtrType* borrowed_ptr_type(const Type* referenced_type, int addr_space = 0, unsigned align = 0) {
+        return unify(new BorrowedPtrType(*this, referenced_type, addr_space, align));
     }
     const DefiniteArrayType* definite_array_type(const Type* elem_type, uint64_t dim) {
         return unify(new DefiniteArrayType(*this, elem_type, dim));
@@ -24,12 +24,12 @@ public:
         return unify(new IndefiniteArrayType(*this, elem_type));
     }
     const SimdType* simd_type(const Type* elem_type, uint64_t size) { return unify(new SimdType(*this, elem_type, size)); }
-    const MutPtrType* mut_ptr_type(const Type* referenced_type, int addr_space = 0) {
-        return unify(new MutPtrType(*this, referenced_type, addr_space));
+    const MutPtrType* mut_ptr_type(const Type* referenced_type, int addr_space = 0, unsigned align = 0) {
+        return unify(new MutPtrType(*this, referenced_type, addr_space, align));
     }
     const NoRetType* type_noret() { return type_noret_; }
-    const OwnedPtrType* owned_ptr_type(const Type* referenced_type, int addr_space = 0) {
-        return unify(new OwnedPtrType(*this, referenced_type, addr_space));
+    const OwnedPtrType* owned_ptr_type(const Type* referenced_type, int addr_space = 0, unsigned align = 0) {
+        return unify(new OwnedPtrType(*this, referenced_type, addr_space, align));
     }
     const PrimType* prim_type(PrimTypeKind kind);
     const UnknownType* unknown_type() { return unify(new UnknownType(*this)); }
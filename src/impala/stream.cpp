@@ -1,4 +1,5 @@
 #include "impala/ast.h"
+#include "impala/bf16.h"
 #include "impala/impala.h"
 
 namespace impala {
@@ -17,12 +18,18 @@ std::ostream& PtrASTType::stream(std::ostream& os) const {
     os << prefix();
     if (addr_space() != 0)
         os << '[' << addr_space() << ']';
+    if (align() != 0)
+        os << "align(" << align() << ") ";
     return os << referenced_ast_type();
 }
 
 std::ostream& DefiniteArrayASTType::stream(std::ostream& os) const { return streamf(os, "[% * %]", elem_ast_type(), dim()); }
 std::ostream& IndefiniteArrayASTType::stream(std::ostream& os) const { return streamf(os, "[%]", elem_ast_type()); }
-std::ostream& SimdASTType::stream(std::ostream& os) const { return streamf(os, "simd[% * %]", elem_ast_type(), size()); }
+std::ostream& SimdASTType::stream(std::ostream& os) const {
+    if (is_native())
+        return streamf(os, "simd[% * native]", elem_ast_type());
+    return streamf(os, "simd[% * %]", elem_ast_type(), size());
+}
 
 std::ostream& TupleASTType::stream(std::ostream& os) const {
     return stream_list(os, ast_type_args(), [&](const auto& ast_type) { os << ast_type.get(); }, "(", ")");
@@ -139,6 +146,14 @@ std::ostream& ExternBlock::stream(std::ostream& os) const {
 }
 
 std::ostream& FnDecl::stream(std::ostream& os) const {
+    if (is_fast_math())
+        os << "#[fast_math] ";
+    if (has_target_clones()) {
+        os << "#[target_clones";
+        if (!target_clones().empty())
+            stream_list(os, target_clones(), [&](const auto& feature) { os << '"' << feature << '"'; }, "(", ")", ", ");
+        os << "] ";
+    }
     if (is_extern())
         os << "extern ";
     os << "fn ";
@@ -175,6 +190,8 @@ std::ostream& FieldDecl::stream(std::ostream& os) const {
 }
 
 std::ostream& StaticItem::stream(std::ostream& os) const {
+    if (align() != 0)
+        os << "#[align(" << align() << ")] ";
     streamf(os, "static % %: %", is_mut() ? "mut " : "", identifier(), type() ? type()->to_string() : ast_type()->to_string());
     if (init())
         streamf(os, " = %", init());
@@ -182,6 +199,8 @@ std::ostream& StaticItem::stream(std::ostream& os) const {
 }
 
 std::ostream& StructDecl::stream(std::ostream& os) const {
+    if (align() != 0)
+        os << "#[align(" << align() << ")] ";
     stream_ast_type_params(streamf(os, "%struct %", visibility().str(), symbol())) << " {" << up << endl;
     return stream_list(os, field_decls(), [&](const auto& field) { os << field.get(); }, "", "", ",", true) << down << endl << "}";
 }
@@ -219,6 +238,8 @@ std::ostream& ImplItem::stream(std::ostream& os) const {
  */
 
 std::ostream& BlockExprBase::stream(std::ostream& os) const {
+    if (is_fast_math())
+        os << "#[fast_math] ";
     os << prefix();
     if (empty())
         return os << endl << '}';
@@ -245,6 +266,7 @@ std::ostream& LiteralExpr::stream(std::ostream& os) const {
         case LIT_u32: return os <<      box().get_s32() << "u";
         case LIT_u64: return os <<      box().get_s64() << "u64";
         case LIT_f16: return os <<      box().get_f16() << "h";
+        case LIT_bf16: return os << bf16_to_float(box().get_u16()) << "bf16";
         case LIT_f32: return os <<      box().get_f32() << "f";
         case LIT_f64: return os <<      box().get_f64() << "f64";
         case LIT_bool: return os << (box().get_bool() ? "true" : "false");
@@ -299,6 +321,8 @@ std::ostream& PrefixExpr::stream(std::ostream& os) const {
     }
 
     os << op;
+    if (is_mut())
+        os << "mut ";
     prec = r;
     os << rhs();
     prec = old;
@@ -22,11 +22,12 @@ public:
     Symbol(const std::string& str) { insert(str.c_str()); }
 
     const char* str() const { return str_; }
-    operator bool() const { return *this != Symbol(""); }
+    operator bool() const { return !empty(); }
     bool operator == (Symbol symbol) const { return str() == symbol.str(); }
     bool operator != (Symbol symbol) const { return str() != symbol.str(); }
-    bool operator == (const char* s) const { return str() == Symbol(s).str(); }
-    bool operator != (const char* s) const { return str() != Symbol(s).str(); }
+    /// Compares the characters - interning @p s just for the comparison would insert it into the table.
+    bool operator == (const char* s) const { return std::strcmp(str(), s) == 0; }
+    bool operator != (const char* s) const { return std::strcmp(str(), s) != 0; }
     bool empty() const { return *str_ == '\0'; }
     bool is_anonymous() { return (*this) == "_"; }
     std::string remove_quotation() const;
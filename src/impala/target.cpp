@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <sstream>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/Triple.h>
+#include <llvm/Support/Host.h>
+
+#include "impala/target.h"
+
+namespace impala {
+
+TargetFeature target_feature(const std::string& name) {
+#define IMPALA_TARGET(id, str, leaf, reg, bit, xcr0) if (name == str) return TargetFeature_##id;
+#include "impala/targetlist.h"
+    return Num_TargetFeatures;
+}
+
+const char* target_feature_name(TargetFeature feature) {
+    switch (feature) {
+#define IMPALA_TARGET(id, str, leaf, reg, bit, xcr0) case TargetFeature_##id: return str;
+#include "impala/targetlist.h"
+        default: return "<unknown>";
+    }
+}
+
+Target resolve_native(const Target& target) {
+    if (target.cpu != "native")
+        return target;
+
+    llvm::StringMap<bool> host;
+    std::vector<std::string> features;
+    if (llvm::sys::getHostCPUFeatures(host)) {
+        for (const auto& feature : host)
+            features.push_back((feature.getValue() ? "+" : "-") + feature.getKey().str());
+        std::sort(features.begin(), features.end());
+    }
+    if (!target.features.empty())
+        features.push_back(target.features); // explicit features override the host's - the last one wins
+
+    std::string list;
+    for (const auto& feature : features)
+        list += (list.empty() ? "" : ",") + feature;
+    return {llvm::sys::getHostCPUName().str(), list};
+}
+
+bool is_x86_target() {
+    llvm::Triple triple(llvm::sys::getDefaultTargetTriple());
+    return triple.getArch() == llvm::Triple::x86 || triple.getArch() == llvm::Triple::x86_64;
+}
+
+/// Widest vector registers of some CPUs known to LLVM - other CPUs are assumed to have 128 bits.
+static size_t cpu_simd_width(const std::string& cpu) {
+    static const char* avx512[] = { "knl", "knm", "skylake-avx512", "cascadelake", "cooperlake", "cannonlake",
+                                    "icelake-client", "icelake-server", "tigerlake", "sapphirerapids", "znver4" };
+    static const char* avx[]    = { "sandybridge", "ivybridge", "haswell", "broadwell", "skylake", "alderlake",
+                                    "btver2", "bdver1", "bdver2", "bdver3", "bdver4", "znver1", "znver2", "znver3" };
+    auto is = [&] (const char* name) { return cpu == name; };
+    if (std::any_of(std::begin(avx512), std::end(avx512), is)) return 512;
+    if (std::any_of(std::begin(avx),    std::end(avx),    is)) return 256;
+    return 128;
+}
+
+size_t simd_width(const Target& target) {
+    auto resolved = resolve_native(target);
+
+    // explicit features override the CPU's - the last one wins
+    size_t width = cpu_simd_width(resolved.cpu);
+    std::istringstream list(resolved.features);
+    std::string feature;
+    while (std::getline(list, feature, ',')) {
+        if (feature == "+avx512f")                      width = std::max(width, size_t(512));
+        if (feature == "+avx" || feature == "+avx2")    width = std::max(width, size_t(256));
+        if (feature == "-avx512f")                      width = std::min(width, size_t(256));
+        if (feature == "-avx")                          width = std::min(width, size_t(128));
+    }
+    return width;
+}
+
+}
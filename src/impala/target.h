@@ -0,0 +1,44 @@
+#ifndef IMPALA_TARGET_H
+#define IMPALA_TARGET_H
+
+#include <string>
+#include <vector>
+
+namespace impala {
+
+/// The features of @c #[target_clones] - their order is the order of preference.
+enum TargetFeature {
+#define IMPALA_TARGET(id, name, leaf, reg, bit, xcr0) TargetFeature_##id,
+#include "impala/targetlist.h"
+    Num_TargetFeatures
+};
+
+/// The @p TargetFeature called @p name or @c Num_TargetFeatures if there is none.
+TargetFeature target_feature(const std::string& name);
+/// Also the name of the feature in LLVM.
+const char* target_feature_name(TargetFeature);
+
+/// The target selected with the driver options @c -target-cpu and @c -target-features.
+struct Target {
+    std::string cpu;      ///< LLVM name of the CPU or @c native for the host; empty for LLVM's default.
+    std::string features; ///< Comma-separated LLVM features such as <tt>+avx2,-avx512f</tt>.
+};
+
+/// @p target with @c native replaced by the name and all features of the host CPU as LLVM detects them.
+Target resolve_native(const Target& target);
+/// Whether LLVM's default target - the one of Thorin's CPU backend - is x86, the only one with @c cpuid.
+bool is_x86_target();
+/// Width of the vector registers of @p target in bits.
+size_t simd_width(const Target& target);
+
+/// A function emitted for one of the features of a @c #[target_clones] attribute.
+struct TargetClone {
+    std::string name; ///< External name of the clone.
+    TargetFeature feature;
+};
+
+typedef std::vector<TargetClone> TargetClones;
+
+}
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef IMPALA_TARGET
+#define IMPALA_TARGET(id, name, leaf, reg, bit, xcr0)
+#endif
+
+// features accepted by #[target_clones], from the least to the most preferred one
+// leaf, reg and bit locate the flag reporting the feature in the result of the x86 instruction cpuid
+// xcr0 are the bits of the register state which the OS must save in XCR0 - 0 if the feature needs no extra state
+IMPALA_TARGET(sse4_1,  "sse4.1",  1, ecx, 19, 0x00)
+IMPALA_TARGET(sse4_2,  "sse4.2",  1, ecx, 20, 0x00)
+IMPALA_TARGET(avx,     "avx",     1, ecx, 28, 0x06) // SSE and AVX state
+IMPALA_TARGET(avx2,    "avx2",    7, ebx,  5, 0x06)
+IMPALA_TARGET(avx512f, "avx512f", 7, ebx, 16, 0xe6) // additionally opmask and ZMM state
+
+#undef IMPALA_TARGET
@@ -2,11 +2,13 @@
 
 #include <algorithm>
 #include <cerrno>
+#include <cmath>
 #include <cstdlib>
 #include <limits>
 
 #include "thorin/util/cast.h"
 
+#include "impala/bf16.h"
 #include "impala/impala.h"
 
 using namespace thorin;
@@ -81,7 +83,8 @@ Token::Token(Location location, Kind kind, const std::string& str)
         case LIT_u8: case LIT_u16: case LIT_u32: case LIT_u64:
                       uval = strtoull(nptr, 0, base);  err = errno; break;
         case LIT_f16: hval = strtof(symbol_.str(), 0); err = errno; break; // TODO: errno for half not correctly set
-        case LIT_f32: fval = strtof(symbol_.str(), 0); err = errno; break;
+        case LIT_f32:
+        case LIT_bf16: fval = strtof(symbol_.str(), 0); err = errno; break;
         case LIT_f64: dval = strtod(symbol_.str(), 0); err = errno; break;
         default: THORIN_UNREACHABLE;
     }
@@ -97,6 +100,7 @@ Token::Token(Location location, Kind kind, const std::string& str)
         case LIT_u64: box_ = uint64_t(uval); err |= !inrange<uint64_t>(uval); break;
         case LIT_f16: box_ =     half(hval); err |= !inrange<    half>(hval); break;
         case LIT_f32: box_ =    float(fval); err |= !inrange<   float>(fval); break;
+        case LIT_bf16: box_ = bf16_from_float(fval); err |= std::isinf(bf16_to_float(box_.get_u16())); break;
         case LIT_f64: box_ =   double(dval); err |= !inrange<  double>(dval); break;
         default: THORIN_UNREACHABLE;
     }
@@ -228,6 +232,7 @@ void Token::init() {
 
     sym2lit_["h"]   = LIT_f16; sym2flit_["h"]   = LIT_f16;
     sym2lit_["f16"] = LIT_f16; sym2flit_["f16"] = LIT_f16;
+    sym2lit_["bf16"] = LIT_bf16; sym2flit_["bf16"] = LIT_bf16;
     sym2lit_["f"]   = LIT_f32; sym2flit_["f"]   = LIT_f32;
     sym2lit_["f32"] = LIT_f32; sym2flit_["f32"] = LIT_f32;
     sym2lit_["f64"] = LIT_f64; sym2flit_["f64"] = LIT_f64;
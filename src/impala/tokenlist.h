@@ -124,6 +124,7 @@ IMPALA_MISC(COLON,        ":")
 IMPALA_MISC(DOUBLE_COLON, ":")
 IMPALA_MISC(COMMA,        ",")
 IMPALA_MISC(DOTDOT,       "..")
+IMPALA_MISC(HASH,         "#")
 
 #undef IMPALA_MISC
 
@@ -140,6 +141,7 @@ IMPALA_LIT(u16, pu16)
 IMPALA_LIT(u32, pu32)
 IMPALA_LIT(u64, pu64)
 IMPALA_LIT(f16, pf16)
+IMPALA_LIT(bf16, pu16) // bits of a bfloat16; see impala/bf16.h
 IMPALA_LIT(f32, pf32)
 IMPALA_LIT(f64, pf64)
 
@@ -158,6 +160,7 @@ IMPALA_TYPE(u16,  pu16)
 IMPALA_TYPE(u32,  pu32)
 IMPALA_TYPE(u64,  pu64)
 IMPALA_TYPE(f16,  pf16)
+IMPALA_TYPE(bf16, pu16) // bits of a bfloat16; see impala/bf16.h
 IMPALA_TYPE(f32,  pf32)
 IMPALA_TYPE(f64,  pf64)
 IMPALA_TYPE(bool, bool)
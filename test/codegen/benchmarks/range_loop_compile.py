@@ -0,0 +1,59 @@
+#!/usr/bin/env python
+
+"""Usage: range_loop_compile.py <impala executable> [number of loops]
+
+Compares the compile time and the size of the emitted LLVM IR of for loops over a range iterator which the frontend
+recognizes and emits as loops with the same loops over an '@'-annotated iterator that goes through partial evaluation.
+The run time of both is compared by range_loop.impala.
+"""
+
+import os, shutil, subprocess, sys, tempfile, time
+
+ITERATORS = '''
+fn range(a: int, b: int, body: fn(int) -> ()) -> () {
+    if a < b {
+        body(a);
+        range(a+1, b, body, return)
+    }
+}
+
+fn pe_range(a: int, b: int, body: fn(int) -> ()) -> () @{
+    if a < b {
+        body(a);
+        pe_range(a+1, b, body, return)
+    }
+}
+'''
+
+def module(iterator, num_loops):
+    loops = "".join("    for i in %s(0, n) { for j in %s(0, n) { s += (i ^ j) & %d; } }\n" % (iterator, iterator, k)
+                    for k in range(num_loops))
+    return ITERATORS + "extern fn loops(n: int) -> int {\n    let mut s = 0;\n" + loops + "    s\n}\n"
+
+def measure(impala, iterator, num_loops, directory):
+    src = os.path.join(directory, iterator + ".impala")
+    with open(src, "w") as f:
+        f.write(module(iterator, num_loops))
+    start = time.time()
+    subprocess.check_call([impala, "-emit-llvm", "-O3", src], cwd=directory)
+    seconds = time.time() - start
+    with open(os.path.join(directory, iterator + ".ll")) as f:
+        lines = sum(1 for _ in f)
+    return seconds, lines
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit(__doc__)
+    impala = os.path.abspath(sys.argv[1])
+    num_loops = int(sys.argv[2]) if len(sys.argv) > 2 else 50
+
+    directory = tempfile.mkdtemp()
+    try:
+        for iterator in ["range", "pe_range"]:
+            seconds, lines = measure(impala, iterator, num_loops, directory)
+            print("%-8s: %d loops compiled in %.3f s to %d lines of LLVM IR" % (iterator, num_loops, seconds, lines))
+    finally:
+        shutil.rmtree(directory)
+
+if __name__ == "__main__":
+    main()
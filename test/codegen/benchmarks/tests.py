@@ -16,7 +16,10 @@ args = {
     "codegen/benchmarks/mandelbrot.impala" : ["3000"],
     "codegen/benchmarks/meteor.impala" : ["2098"],
     "codegen/benchmarks/nbody.impala" : ["6000000"],
+    "codegen/benchmarks/parallel_mandelbrot.impala" : ["2000", "8"],
+    "codegen/benchmarks/parallel_spectral.impala" : ["1000", "8"],
     "codegen/benchmarks/pidigits.impala" : ["10000"],
+    "codegen/benchmarks/range_loop.impala" : ["10000"],
     "codegen/benchmarks/regex.impala" : [],
     "codegen/benchmarks/reverse.impala" : [],
     "codegen/benchmarks/spectral.impala" : ["1800"],
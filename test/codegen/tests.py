@@ -17,7 +17,6 @@ def allTests():
       "codegen/diderot.impala",
       "codegen/endless_mangling.impala",
       "codegen/ldg.impala",
-      "codegen/parallel.impala",
       "codegen/poly_type_arg.impala",
       "codegen/range.impala",
       "codegen/range_poly.impala",
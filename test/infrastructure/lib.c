@@ -1,5 +1,12 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
+#ifdef __linux__
+#include <sys/sysinfo.h>
+#endif
 
 void print_char(char c) {
    printf("%c\n", (int)c);
@@ -98,3 +105,217 @@ void* impala_realloc(void* ptr, int size) {
 void impala_memmove(char* dest, const char* src, int size) {
     __builtin_memmove(dest, src, size);
 }
+
+// timing for benchmarks
+long long get_micro_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+void print_parallel_timing(int threads, long long time, long long baseline) {
+    printf("threads: %2d  time: %10lld us  speedup: %5.2f\n", threads, time, (double)baseline / (double)time);
+}
+
+/*
+ * CPU runtime for the parallel, spawn and sync intrinsics
+ *
+ * Thorin lowers
+ *      parallel(num_threads, lower, upper, body) to parallel_for(num_threads, lower, upper, closure, fun),
+ *      spawn(body) to parallel_spawn(closure, fun), and
+ *      sync(id) to parallel_sync(id).
+ * parallel_for uses one work-stealing deque per worker:
+ * a worker splits its range in halves until it is not larger than the grain size and keeps the lower half;
+ * the upper halves are exposed to thieves which steal the oldest (= largest) range.
+ * If num_threads is 0, the environment variable IMPALA_NUM_THREADS or else the number of cores is used.
+ */
+
+typedef void (*parallel_body_t)(void*, int32_t, int32_t);
+typedef void (*spawn_body_t)(void*);
+
+#define DEQUE_SIZE 64 // splitting in halves pushes at most log2(upper - lower) ranges
+
+typedef struct {
+    pthread_mutex_t lock;
+    int32_t lower[DEQUE_SIZE];
+    int32_t upper[DEQUE_SIZE];
+    unsigned head; // thieves steal here
+    unsigned tail; // owner pushes and pops here
+} deque_t;
+
+typedef struct {
+    deque_t* deques;
+    int num_workers;
+    int32_t grain;
+    int64_t remaining; // number of iterations which have not been executed yet
+    void* closure;
+    parallel_body_t body;
+} parallel_job_t;
+
+typedef struct {
+    parallel_job_t* job;
+    int id;
+} parallel_worker_t;
+
+static void deque_push(deque_t* deque, int32_t lower, int32_t upper) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail - deque->head == DEQUE_SIZE) {
+        fprintf(stderr, "parallel_for: deque overflow\n");
+        abort();
+    }
+    deque->lower[deque->tail % DEQUE_SIZE] = lower;
+    deque->upper[deque->tail % DEQUE_SIZE] = upper;
+    ++deque->tail;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static int deque_pop(deque_t* deque, int32_t* lower, int32_t* upper) {
+    int result = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail != deque->head) {
+        --deque->tail;
+        *lower = deque->lower[deque->tail % DEQUE_SIZE];
+        *upper = deque->upper[deque->tail % DEQUE_SIZE];
+        result = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return result;
+}
+
+static int deque_steal(deque_t* deque, int32_t* lower, int32_t* upper) {
+    int result = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail != deque->head) {
+        *lower = deque->lower[deque->head % DEQUE_SIZE];
+        *upper = deque->upper[deque->head % DEQUE_SIZE];
+        ++deque->head;
+        result = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return result;
+}
+
+static void* parallel_worker(void* arg) {
+    parallel_worker_t* worker = (parallel_worker_t*)arg;
+    parallel_job_t* job = worker->job;
+    deque_t* own = &job->deques[worker->id];
+    int32_t lower, upper;
+
+    while (__atomic_load_n(&job->remaining, __ATOMIC_ACQUIRE) > 0) {
+        int found = deque_pop(own, &lower, &upper);
+        for (int i = 1; !found && i != job->num_workers; ++i)
+            found = deque_steal(&job->deques[(worker->id + i) % job->num_workers], &lower, &upper);
+
+        if (!found) {
+            sched_yield();
+            continue;
+        }
+
+        while (upper - lower > job->grain) {
+            int32_t mid = lower + (upper - lower) / 2;
+            deque_push(own, mid, upper);
+            upper = mid;
+        }
+
+        job->body(job->closure, lower, upper);
+        __atomic_sub_fetch(&job->remaining, (int64_t)(upper - lower), __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+static int default_num_threads() {
+    const char* env = getenv("IMPALA_NUM_THREADS");
+#ifdef __linux__
+    int num_threads = env ? atoi(env) : get_nprocs();
+#else
+    int num_threads = env ? atoi(env) : 4;
+#endif
+    return num_threads > 0 ? num_threads : 1;
+}
+
+void parallel_for(int32_t num_threads, int32_t lower, int32_t upper, void* closure, void* fun) {
+    if (lower >= upper)
+        return;
+
+    int num_workers = num_threads > 0 ? num_threads : default_num_threads();
+    int64_t num_iters = (int64_t)upper - (int64_t)lower;
+    int64_t grain = num_iters / (8 * num_workers); // 8 chunks per worker for load balancing
+
+    parallel_job_t job;
+    job.deques = (deque_t*)malloc(num_workers * sizeof(deque_t));
+    job.num_workers = num_workers;
+    job.grain = grain > 0 ? (int32_t)grain : 1;
+    job.remaining = num_iters;
+    job.closure = closure;
+    job.body = (parallel_body_t)fun;
+
+    for (int i = 0; i != num_workers; ++i) {
+        pthread_mutex_init(&job.deques[i].lock, NULL);
+        job.deques[i].head = job.deques[i].tail = 0;
+    }
+    deque_push(&job.deques[0], lower, upper);
+
+    parallel_worker_t* workers = (parallel_worker_t*)malloc(num_workers * sizeof(parallel_worker_t));
+    pthread_t* threads = (pthread_t*)malloc(num_workers * sizeof(pthread_t));
+    for (int i = 0; i != num_workers; ++i) {
+        workers[i].job = &job;
+        workers[i].id = i;
+    }
+
+    // the calling thread acts as worker 0
+    for (int i = 1; i != num_workers; ++i)
+        pthread_create(&threads[i], NULL, parallel_worker, &workers[i]);
+    parallel_worker(&workers[0]);
+    for (int i = 1; i != num_workers; ++i)
+        pthread_join(threads[i], NULL);
+
+    for (int i = 0; i != num_workers; ++i)
+        pthread_mutex_destroy(&job.deques[i].lock);
+    free(threads);
+    free(workers);
+    free(job.deques);
+}
+
+#define MAX_SPAWNED 4096 // threads spawned but not yet synced
+
+typedef struct {
+    void* closure;
+    spawn_body_t body;
+} spawned_t;
+
+static pthread_t spawned_threads[MAX_SPAWNED];
+static int num_spawned = 0;           // ids below have been handed out at least once
+static int32_t free_ids[MAX_SPAWNED]; // ids released by parallel_sync
+static int num_free = 0;
+static pthread_mutex_t spawn_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void* spawned_thread(void* arg) {
+    spawned_t spawned = *(spawned_t*)arg;
+    free(arg);
+    spawned.body(spawned.closure);
+    return NULL;
+}
+
+int32_t parallel_spawn(void* closure, void* fun) {
+    spawned_t* spawned = (spawned_t*)malloc(sizeof(spawned_t));
+    spawned->closure = closure;
+    spawned->body = (spawn_body_t)fun;
+
+    pthread_mutex_lock(&spawn_lock);
+    if (num_free == 0 && num_spawned == MAX_SPAWNED) {
+        fprintf(stderr, "parallel_spawn: too many threads\n");
+        abort();
+    }
+    int32_t id = num_free != 0 ? free_ids[--num_free] : num_spawned++;
+    pthread_create(&spawned_threads[id], NULL, spawned_thread, spawned);
+    pthread_mutex_unlock(&spawn_lock);
+    return id;
+}
+
+void parallel_sync(int32_t id) {
+    pthread_join(spawned_threads[id], NULL);
+    pthread_mutex_lock(&spawn_lock);
+    free_ids[num_free++] = id;
+    pthread_mutex_unlock(&spawn_lock);
+}
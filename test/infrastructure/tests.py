@@ -5,7 +5,7 @@ Created on 8 Dec 2013
 '''
 
 from __future__ import absolute_import
-import sys, os, difflib, shutil, imp, tempfile
+import sys, os, re, difflib, shutil, imp, tempfile
 from .timed_process import CompileProcess, RuntimeProcess
 from .valgrindxml import ValgrindXML
 import traceback
@@ -99,6 +99,66 @@ def diff_output(output, expected):
 
     return True if fails == 0 else False
 
+def check_pattern(pattern):
+    """Turns a FileCheck-style pattern - literal text with {{regex}} blocks - into a regex"""
+    regex = ""
+    for i, part in enumerate(re.split(r"\{\{(.*?)\}\}", pattern)):
+        regex += part if i % 2 == 1 else re.escape(part)
+    return re.compile(regex)
+
+def get_checks(srcfile):
+    """Yields (directive, pattern) for each '// CHECK:', '// CHECK-NOT:' and '// CHECK-DAG:' line of srcfile"""
+    with open(srcfile, 'r') as f:
+        for line in f:
+            m = re.search(r"//\s*(CHECK|CHECK-NOT|CHECK-DAG):(.*)$", line)
+            if m:
+                yield (m.group(1), m.group(2).strip())
+
+def check_ll(ll, checks):
+    """Matches the CHECK lines in order against the lines of ll; a CHECK-NOT must not match
+    between the previous and the next CHECK; a CHECK-DAG matches anywhere after the previous CHECK"""
+    lines = ll.splitlines()
+    pos = 0
+    nots = []
+
+    def check_nots(end):
+        for pattern in nots:
+            for line in lines[pos:end]:
+                if check_pattern(pattern).search(line):
+                    print("  CHECK-NOT: '%s' matched '%s'" % (pattern, line.strip()))
+                    return False
+        return True
+
+    for directive, pattern in checks:
+        if directive == "CHECK-NOT":
+            nots.append(pattern)
+            continue
+        regex = check_pattern(pattern)
+        if directive == "CHECK-DAG":
+            if not any(regex.search(line) for line in lines[pos:]):
+                print("  CHECK-DAG: '%s' not found" % pattern)
+                return False
+            continue
+        found = next((i for i in range(pos, len(lines)) if regex.search(lines[i])), None)
+        if found is None:
+            print("  CHECK: '%s' not found" % pattern)
+            return False
+        if not check_nots(found):
+            return False
+        pos = found + 1
+        nots = []
+
+    return check_nots(len(lines))
+
+def get_options(srcfile):
+    """Returns the compiler options of the '// OPTIONS:' line of srcfile - none if there is no such line"""
+    with open(srcfile, 'r') as f:
+        for line in f:
+            m = re.search(r"//\s*OPTIONS:(.*)$", line)
+            if m:
+                return m.group(1).split()
+    return []
+
 class CompilerOutputTest(Test):
     """Superclass tests which work on a single file and compare the output."""
     positive = True
@@ -167,10 +227,10 @@ class InvokeTest(Test):
         yield [gEx] + self.options + [os.path.join(self.basedir, self.srcfile)]
         if(self.benchmarks):
             yield ["clang", "-O3", InvokeTest.LIB_C, "-c"]
-            yield ["clang", "-O3", "lib.o", self.ll_file, "-L", "/opt/local/lib", "-lm", "-lpcre", "-lgmp", "-s", "-o", self.exe_file]
+            yield ["clang", "-O3", "lib.o", self.ll_file, "-L", "/opt/local/lib", "-lm", "-lpcre", "-lgmp", "-pthread", "-s", "-o", self.exe_file]
         else:
             yield ["llc", "-o", self.s_file, self.ll_file]
-            yield ["cc", "-o", self.exe_file, self.s_file, InvokeTest.LIB_C]
+            yield ["cc", "-o", self.exe_file, self.s_file, InvokeTest.LIB_C, "-pthread"]
 
 
     def invoke(self, gEx):
@@ -183,11 +243,13 @@ class InvokeTest(Test):
         #        return False
 
         try:
-            for phase in self.compilePhases(gEx):
+            for i, phase in enumerate(self.compilePhases(gEx)):
                 p = CompileProcess(phase, ".")
                 p.execute()
                 if not (self.checkBasics(p) and self.compilationSuccess(p)):
                     return False
+                if i == 0 and not self.checkLL():
+                    return False
 
             # run executable
             if self.args is None:
@@ -226,6 +288,21 @@ class InvokeTest(Test):
                         return diff_output(f.read(), g.read())
         return True
 
+    def checkLL(self):
+        """Checks the emitted LLVM IR against the '// CHECK' lines of the source file"""
+        checks = list(get_checks(os.path.join(self.basedir, self.srcfile)))
+        if not checks:
+            return True
+
+        with open(self.ll_file, 'r') as f:
+            if check_ll(f.read(), checks):
+                return True
+
+        print("[FAIL] "+os.path.join(self.basedir, self.srcfile))
+        print("  LLVM IR in '%s' does not match the CHECK lines" % self.ll_file)
+        print
+        return False
+
     def cleanup(self, file):
         if os.path.exists(file):
             os.remove(file)
@@ -237,6 +314,35 @@ class InvokeTest(Test):
             return False
         return True
 
+class OutputCheckTest(Test):
+    """Compiles a single file with the options of its '// OPTIONS:' line and matches its '// CHECK' lines against the
+    output of the compiler instead of the LLVM IR - for reports and warnings"""
+    basedir = "."
+    srcfile = ""
+
+    def __init__(self, base, src):
+        super(OutputCheckTest, self).__init__(base, src, get_options(os.path.join(base, src)))
+
+    def invoke(self, gEx):
+        p = CompileProcess([gEx] + self.options + [self.srcfile], self.basedir)
+        p.execute()
+        if not self.checkBasics(p):
+            return False
+
+        output = p.output.decode('utf-8')
+        if not p.success():
+            print("[FAIL] "+os.path.join(self.basedir, self.srcfile))
+            print("Output: "+output)
+            return False
+
+        if check_ll(output, list(get_checks(os.path.join(self.basedir, self.srcfile)))):
+            return True
+
+        print("[FAIL] "+os.path.join(self.basedir, self.srcfile))
+        print("  Compiler output does not match the CHECK lines:")
+        print(output)
+        return False
+
 def get_tests(directory):
     """A generator for test files based on the .impala files in directory
 
@@ -274,6 +380,11 @@ def make_invoke_tests(directory, options=[], benchmarks=False, testToFile={}, in
             tests.append(InvokeTest(directory, testfile, res, options, benchmarks, None, input_file))
     return sorted(tests, key=lambda test: test.getName())
 
+def make_output_check_tests(directory):
+    """Creates a list of OutputCheckTests using get_tests(directory)"""
+    tests = [OutputCheckTest(directory, testfile) for testfile, _ in get_tests(directory)]
+    return sorted(tests, key=lambda test: test.getName())
+
 def get_tests_for_file(file):
     directory = os.path.dirname(file)
     filename = os.path.basename(file)
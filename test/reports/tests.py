@@ -0,0 +1,12 @@
+"""
+tests.py for the reports and warnings of the compiler - the CHECK lines are matched against the compiler's output
+"""
+
+# import the test infrastructure
+from infrastructure.tests import make_output_check_tests
+
+def allTests():
+    """
+    This function returns a list of tests.
+    """
+    return make_output_check_tests("reports")